@@ -31,17 +31,19 @@
 /**
  * @nog_struct Channel
  * @module builtins
- * @description A typed channel for communication between goroutines.
+ * @description A typed channel for communication between goroutines. Channel<T>(n) buffers up to n values (default 1); Channel<T>(0) is unbuffered and send blocks until a receiver takes the value.
  * @example
  * ch := Channel<int>();
  * ch.send(42);
  * val := ch.recv();
+ * jobs := Channel<str>(64);
+ * handoff := Channel<int>(0);
  */
 
 /**
  * @nog_method send
  * @type Channel
- * @description Sends a value through the channel (blocks until received).
+ * @description Sends a value through the channel (blocks while the buffer is full; on unbuffered channels, until received).
  * @param value T - The value to send
  * @example ch.send(42);
  */
@@ -262,6 +264,12 @@ string generate_with_imports(
         }
 
         out += "\nint main() {\n";
+
+        if (string rt_config = runtime_config(state); !rt_config.empty()) {
+            out += rt_config;
+            out += "\tbishop::rt::configure(_rt_config);\n";
+        }
+
         out += "\tbishop::rt::init_runtime();\n";
         out += "\n";
 
@@ -269,7 +277,8 @@ string generate_with_imports(
             out += "\tbishop::rt::run_in_fiber(" + name + ");\n";
         }
 
-        out += "\treturn _failures;\n";
+        // Goroutines the tests left running, such as servers, are not joined
+        out += "\tbishop::rt::exit(_failures);\n";
         out += "}\n";
     }
 
@@ -281,6 +290,7 @@ string generate_with_imports(
 // Legacy class API for backwards compatibility
 string CodeGen::generate(const unique_ptr<Program>& program, bool test_mode) {
     CodeGenState state;
+    state.runtime = runtime;
     return codegen::generate(state, program, test_mode);
 }
 
@@ -290,5 +300,6 @@ string CodeGen::generate_with_imports(
     bool test_mode
 ) {
     CodeGenState state;
+    state.runtime = runtime;
     return codegen::generate_with_imports(state, program, imports, test_mode);
 }
@@ -10,10 +10,28 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <set>
 #include <vector>
 #include "parser/ast.hpp"
 #include "project/module.hpp"
 
+/**
+ * A route registered with a literal path and a named handler function.
+ */
+struct StaticRoute {
+    std::string method;
+    std::string path;
+    std::string handler;   // emitted C++ function name
+};
+
+/**
+ * An http.App folded into a generated dispatcher.
+ */
+struct StaticApp {
+    std::vector<std::string> middleware;   // emitted C++ function names, outermost first
+    std::vector<StaticRoute> routes;
+};
+
 /**
  * @brief Code generator state passed to all generation functions.
  *
@@ -25,6 +43,10 @@ struct CodeGenState {
     const Program* current_program = nullptr;
     std::map<std::string, const Module*> imported_modules;
     std::map<std::string, const ExternFunctionDef*> extern_functions;
+    RuntimeSettings runtime;  // from bishop.toml, emitted into main()
+    std::set<const ASTNode*> moved_sends;  // send() calls whose value is moved (see emit_move.cpp)
+    std::set<const ASTNode*> static_route_stmts;  // App declarations and registrations folded away (see emit_routes.cpp)
+    std::map<const ASTNode*, StaticApp> static_apps;  // folded App's listen() -> its middleware and routes
 };
 
 namespace codegen {
@@ -41,6 +63,7 @@ std::string generate_module_namespace(CodeGenState& state, const std::string& na
 
 // FFI emission (emit_ffi.cpp)
 std::string generate_extern_declarations(const std::unique_ptr<Program>& program);
+std::string extern_call(CodeGenState& state, const FunctionCall& call, const ExternFunctionDef& ext);
 
 // Type utilities (emit_type.cpp)
 std::string map_type(const std::string& t);
@@ -71,7 +94,15 @@ std::string emit_address_of(CodeGenState& state, const AddressOf& addr);
 std::string emit_go_spawn(CodeGenState& state, const GoSpawn& spawn);
 
 // Channel (emit_channel.cpp)
-std::string emit_channel_create(const ChannelCreate& channel);
+std::string emit_channel_create(CodeGenState& state, const ChannelCreate& channel);
+
+// Last-use analysis for channel sends (emit_move.cpp)
+void collect_moved_sends(CodeGenState& state, const std::vector<std::unique_ptr<ASTNode>>& body);
+std::set<std::string> variables_read(const ASTNode& node);
+
+// Compile-time http.App routing (emit_routes.cpp)
+void collect_static_routes(CodeGenState& state, const std::vector<std::unique_ptr<ASTNode>>& body);
+std::string emit_static_dispatch(CodeGenState& state, const MethodCall& listen, const StaticApp& app);
 
 // List (emit_list.cpp)
 std::string emit_list_create(const ListCreate& list);
@@ -112,6 +143,7 @@ struct FunctionParam {
 std::string generate_function(CodeGenState& state, const FunctionDef& fn);
 std::string generate_method(CodeGenState& state, const MethodDef& method);
 std::string generate_test_harness(CodeGenState& state, const std::unique_ptr<Program>& program);
+std::string runtime_config(const CodeGenState& state);
 std::string function_def(const std::string& name, const std::vector<FunctionParam>& params, const std::string& return_type, const std::vector<std::string>& body);
 std::string method_def(const std::string& name, const std::vector<std::pair<std::string, std::string>>& params, const std::string& return_type, const std::vector<std::string>& body_stmts);
 
@@ -151,6 +183,8 @@ std::string emit_default_expr(CodeGenState& state, const DefaultExpr& expr);
  */
 class CodeGen {
 public:
+    RuntimeSettings runtime;
+
     std::string generate(const std::unique_ptr<Program>& program, bool test_mode = false);
     std::string generate_with_imports(
         const std::unique_ptr<Program>& program,
@@ -11,11 +11,13 @@ using namespace std;
 namespace codegen {
 
 /**
- * Emits a channel creation using bishop::rt::Channel.
+ * Emits a channel creation using bishop::rt::Channel, passing the
+ * capacity through when one was given.
  */
-string emit_channel_create(const ChannelCreate& channel) {
+string emit_channel_create(CodeGenState& state, const ChannelCreate& channel) {
     string cpp_type = map_type(channel.element_type);
-    return "bishop::rt::Channel<" + cpp_type + ">()";
+    string capacity = channel.capacity ? emit(state, *channel.capacity) : "";
+    return "bishop::rt::Channel<" + cpp_type + ">(" + capacity + ")";
 }
 
 } // namespace codegen
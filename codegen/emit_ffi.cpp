@@ -6,6 +6,8 @@
  */
 
 #include "codegen.hpp"
+#include <fmt/format.h>
+#include <fmt/ranges.h>
 
 using namespace std;
 
@@ -46,4 +48,41 @@ string generate_extern_declarations(const unique_ptr<Program>& program) {
     return out;
 }
 
+/**
+ * Emits a call to an extern function. cstr arguments get .c_str(); calls to
+ * @extern(..., blocking) functions run on the offload pool. Their arguments
+ * are evaluated on the calling fiber and captured by value, so only the C
+ * call itself leaves the fiber's thread.
+ */
+string extern_call(CodeGenState& state, const FunctionCall& call, const ExternFunctionDef& ext) {
+    vector<string> captures;
+    vector<string> args;
+
+    for (size_t i = 0; i < call.args.size(); i++) {
+        string arg_code = emit(state, *call.args[i]);
+        bool is_cstr = i < ext.params.size() && ext.params[i].type == "cstr";
+
+        if (ext.blocking) {
+            string name = "_ffi_arg" + to_string(i);
+            captures.push_back(name + " = " + arg_code);
+            arg_code = name;
+        }
+
+        if (!is_cstr) {
+            args.push_back(arg_code);
+        } else if (ext.blocking || dynamic_cast<const StringLiteral*>(call.args[i].get())) {
+            args.push_back(arg_code + ".c_str()");
+        } else {
+            args.push_back("(" + arg_code + ").c_str()");
+        }
+    }
+
+    if (!ext.blocking) {
+        return function_call(call.name, args);
+    }
+
+    return fmt::format("bishop::rt::offload([{}]() {{ return {}; }})",
+                       fmt::join(captures, ", "), function_call(call.name, args));
+}
+
 } // namespace codegen
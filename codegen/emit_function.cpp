@@ -9,6 +9,7 @@
 #include "codegen.hpp"
 #include <fmt/format.h>
 #include <fmt/ranges.h>
+#include <algorithm>
 
 using namespace std;
 
@@ -37,6 +38,25 @@ string function_def(const string& name, const vector<FunctionParam>& params,
     return out;
 }
 
+/**
+ * Returns the C++ parameter for a function or method taking an http.Next:
+ * a middleware, or a helper it hands its next step to. Such a function is
+ * a template over the next step (see http::Next), and takes its request
+ * by reference, so a chain of them compiles to direct calls. Only the
+ * route's handler at the end of the chain gets a copy.
+ */
+static string next_step_param(const string& type, const string& name) {
+    if (type == "http.Next") {
+        return fmt::format("http::Next<NextStep> {}", name);
+    }
+
+    if (type == "http.Request") {
+        return fmt::format("http::Request& {}", name);
+    }
+
+    return fmt::format("{} {}", map_type(type), name);
+}
+
 /**
  * Emits a method definition as a C++ member function.
  */
@@ -46,13 +66,17 @@ string method_def(const string& name,
                   const vector<string>& body_stmts) {
     string rt = return_type.empty() ? "void" : map_type(return_type);
 
+    bool takes_next = any_of(params.begin(), params.end(),
+                             [](const auto& p) { return p.first == "http.Next"; });
     vector<string> param_strs;
 
     for (const auto& [ptype, pname] : params) {
-        param_strs.push_back(fmt::format("{} {}", map_type(ptype), pname));
+        param_strs.push_back(takes_next ? next_step_param(ptype, pname)
+                                        : fmt::format("{} {}", map_type(ptype), pname));
     }
 
-    string out = fmt::format("\t{} {}({}) {{\n", rt, name, fmt::join(param_strs, ", "));
+    string out = takes_next ? "\ttemplate<typename NextStep>\n" : "";
+    out += fmt::format("\t{} {}({}) {{\n", rt, name, fmt::join(param_strs, ", "));
 
     for (const auto& stmt : body_stmts) {
         out += fmt::format("\t\t{}\n", stmt);
@@ -79,6 +103,86 @@ static string get_cpp_return_type(const string& return_type, const string& error
     return "bishop::rt::Result<" + map_type(return_type) + ">";
 }
 
+/**
+ * Returns statements declaring _rt_config with the bishop.toml [runtime]
+ * settings, or "" if every setting has its default. Only settings that
+ * differ from the defaults are emitted.
+ */
+string runtime_config(const CodeGenState& state) {
+    const RuntimeSettings defaults;
+    string rt_config;
+
+    if (state.runtime.workers != defaults.workers) {
+        rt_config += "\t_rt_config.workers = " + to_string(state.runtime.workers) + ";\n";
+    }
+
+    if (state.runtime.listeners != defaults.listeners) {
+        rt_config += "\t_rt_config.listeners = " + to_string(state.runtime.listeners) + ";\n";
+    }
+
+    if (state.runtime.stack_size != defaults.stack_size) {
+        rt_config += "\t_rt_config.stack_size = " + to_string(state.runtime.stack_size) + ";\n";
+    }
+
+    if (state.runtime.stack_pool != defaults.stack_pool) {
+        rt_config += "\t_rt_config.stack_pool = " + to_string(state.runtime.stack_pool) + ";\n";
+    }
+
+    if (state.runtime.stack_guard != defaults.stack_guard) {
+        rt_config += "\t_rt_config.stack_guard = " + string(state.runtime.stack_guard ? "true" : "false") + ";\n";
+    }
+
+    if (state.runtime.offload_threads != defaults.offload_threads) {
+        rt_config += "\t_rt_config.offload_threads = " + to_string(state.runtime.offload_threads) + ";\n";
+    }
+
+    if (state.runtime.http_idle_timeout_ms != defaults.http_idle_timeout_ms) {
+        rt_config += "\t_rt_config.http_idle_timeout_ms = " + to_string(state.runtime.http_idle_timeout_ms) + ";\n";
+    }
+
+    if (state.runtime.http_body_buffer_bytes != defaults.http_body_buffer_bytes) {
+        rt_config += "\t_rt_config.http_body_buffer_bytes = " + to_string(state.runtime.http_body_buffer_bytes) + ";\n";
+    }
+
+    if (state.runtime.http_max_body_bytes != defaults.http_max_body_bytes) {
+        rt_config += "\t_rt_config.http_max_body_bytes = " + to_string(state.runtime.http_max_body_bytes) + ";\n";
+    }
+
+    if (state.runtime.http_max_connections != defaults.http_max_connections) {
+        rt_config += "\t_rt_config.http_max_connections = " + to_string(state.runtime.http_max_connections) + ";\n";
+    }
+
+    if (state.runtime.http_header_timeout_ms != defaults.http_header_timeout_ms) {
+        rt_config += "\t_rt_config.http_header_timeout_ms = " + to_string(state.runtime.http_header_timeout_ms) + ";\n";
+    }
+
+    if (state.runtime.http_body_timeout_ms != defaults.http_body_timeout_ms) {
+        rt_config += "\t_rt_config.http_body_timeout_ms = " + to_string(state.runtime.http_body_timeout_ms) + ";\n";
+    }
+
+    if (state.runtime.http_write_timeout_ms != defaults.http_write_timeout_ms) {
+        rt_config += "\t_rt_config.http_write_timeout_ms = " + to_string(state.runtime.http_write_timeout_ms) + ";\n";
+    }
+
+    if (state.runtime.http_max_header_bytes != defaults.http_max_header_bytes) {
+        rt_config += "\t_rt_config.http_max_header_bytes = " + to_string(state.runtime.http_max_header_bytes) + ";\n";
+    }
+
+    if (state.runtime.http_compress_min_bytes != defaults.http_compress_min_bytes) {
+        rt_config += "\t_rt_config.http_compress_min_bytes = " + to_string(state.runtime.http_compress_min_bytes) + ";\n";
+    }
+
+    if (state.runtime.http_compress_offload_bytes != defaults.http_compress_offload_bytes) {
+        rt_config += "\t_rt_config.http_compress_offload_bytes = " + to_string(state.runtime.http_compress_offload_bytes) + ";\n";
+    }
+
+    if (rt_config.empty()) {
+        return "";
+    }
+
+    return "\tbishop::rt::RuntimeConfig _rt_config;\n" + rt_config;
+}
+
 /**
  * Generates a C++ function from a Nog FunctionDef.
  * Maps Bishop types to C++ types and handles main() specially.
@@ -98,10 +202,17 @@ string generate_function(CodeGenState& state, const FunctionDef& fn) {
         params.push_back({p.type, p.name});
     }
 
+    collect_moved_sends(state, fn.body);
+    collect_static_routes(state, fn.body);
+
     vector<string> body;
 
     for (const auto& stmt : fn.body) {
-        body.push_back(generate_statement(state, *stmt));
+        string code = generate_statement(state, *stmt);
+
+        if (!code.empty()) {
+            body.push_back(code);
+        }
     }
 
     // Add implicit return {} for Result<void> functions without explicit return
@@ -125,20 +236,33 @@ string generate_function(CodeGenState& state, const FunctionDef& fn) {
 
         // Generate int main() using runtime wrapper
         out += "\nint main() {\n";
-        out += "\tbishop::rt::run(_nog_main);\n";
+
+        string rt_config = runtime_config(state);
+
+        if (!rt_config.empty()) {
+            out += rt_config;
+            out += "\tbishop::rt::run(_nog_main, _rt_config);\n";
+        } else {
+            out += "\tbishop::rt::run(_nog_main);\n";
+        }
+
         out += "\treturn 0;\n";
         out += "}\n";
     } else {
         // Use raw return type string for fallible functions
         string cpp_rt = get_cpp_return_type(fn.return_type, fn.error_type);
 
+        bool takes_next = any_of(params.begin(), params.end(),
+                                 [](const FunctionParam& p) { return p.type == "http.Next"; });
         vector<string> param_strs;
 
         for (const auto& p : params) {
-            param_strs.push_back(fmt::format("{} {}", map_type(p.type), p.name));
+            param_strs.push_back(takes_next ? next_step_param(p.type, p.name)
+                                            : fmt::format("{} {}", map_type(p.type), p.name));
         }
 
-        out = fmt::format("{} {}({}) {{\n", cpp_rt, fn.name, fmt::join(param_strs, ", "));
+        out = takes_next ? "template<typename NextStep>\n" : "";
+        out += fmt::format("{} {}({}) {{\n", cpp_rt, fn.name, fmt::join(param_strs, ", "));
 
         for (const auto& stmt : body) {
             out += fmt::format("\t{}\n", stmt);
@@ -162,10 +286,17 @@ string generate_method(CodeGenState& state, const MethodDef& method) {
         params.push_back({method.params[i].type, method.params[i].name});
     }
 
+    collect_moved_sends(state, method.body);
+    collect_static_routes(state, method.body);
+
     vector<string> body;
 
     for (const auto& stmt : method.body) {
-        body.push_back(generate_statement(state, *stmt));
+        string code = generate_statement(state, *stmt);
+
+        if (!code.empty()) {
+            body.push_back(code);
+        }
     }
 
     return method_def(method.name, params, method.return_type, body);
@@ -237,6 +368,12 @@ string generate_test_harness(CodeGenState& state, const unique_ptr<Program>& pro
     }
 
     out += "\nint main() {\n";
+
+    if (string rt_config = runtime_config(state); !rt_config.empty()) {
+        out += rt_config;
+        out += "\tbishop::rt::configure(_rt_config);\n";
+    }
+
     out += "\tbishop::rt::init_runtime();\n";
     out += "\n";
 
@@ -256,7 +393,8 @@ string generate_test_harness(CodeGenState& state, const unique_ptr<Program>& pro
         }
     }
 
-    out += "\treturn _failures;\n";
+    // Goroutines the tests left running, such as servers, are not joined
+    out += "\tbishop::rt::exit(_failures);\n";
     out += "}\n";
 
     return out;
@@ -22,6 +22,12 @@ string function_call(const string& name, const vector<string>& args) {
  * Emits a function call AST node.
  */
 string emit_function_call(CodeGenState& state, const FunctionCall& call) {
+    auto ext_it = state.extern_functions.find(call.name);
+
+    if (ext_it != state.extern_functions.end()) {
+        return extern_call(state, call, *ext_it->second);
+    }
+
     vector<string> args;
 
     for (const auto& arg : call.args) {
@@ -5,22 +5,110 @@
 
 #include "codegen.hpp"
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 
 using namespace std;
 
 namespace codegen {
 
+/**
+ * Looks up the definition of a called function, in this program or in an
+ * imported module. Returns nullptr for builtins, externs and unknown names.
+ */
+static const FunctionDef* find_callee(const CodeGenState& state, const string& name) {
+    size_t dot_pos = name.find('.');
+
+    if (dot_pos == string::npos) {
+        if (!state.current_program) {
+            return nullptr;
+        }
+
+        for (const auto& fn : state.current_program->functions) {
+            if (fn->name == name) {
+                return fn.get();
+            }
+        }
+
+        return nullptr;
+    }
+
+    auto it = state.imported_modules.find(name.substr(0, dot_pos));
+
+    if (it == state.imported_modules.end() || !it->second->ast) {
+        return nullptr;
+    }
+
+    string fn_name = name.substr(dot_pos + 1);
+
+    for (const auto& fn : it->second->ast->functions) {
+        if (fn->name == fn_name) {
+            return fn.get();
+        }
+    }
+
+    return nullptr;
+}
+
 /**
  * Emits a goroutine spawn using bishop::rt::spawn().
  *
- * Note: Uses [&] capture. The caller must ensure captured variables
- * outlive the goroutine. Proper fix requires shared_ptr for channels.
+ * For a call to a known function the arguments are evaluated at the spawn
+ * site, like Go: each becomes a by-value lambda capture, except channels,
+ * which are captured by reference. The closure stays small enough to live
+ * inside the bishop::rt::Task, so the spawn does not allocate.
+ *
+ * Other calls fall back to a [&] capture; the caller must ensure captured
+ * variables outlive the goroutine.
  */
 string emit_go_spawn(CodeGenState& state, const GoSpawn& spawn) {
-    string call_code = emit(state, *spawn.call);
+    auto* call = dynamic_cast<const FunctionCall*>(spawn.call.get());
+    const FunctionDef* callee = call ? find_callee(state, call->name) : nullptr;
+
+    bool by_value = callee && callee->params.size() == call->args.size();
+
+    // Channels are captured by reference, which needs a named channel
+    for (size_t i = 0; by_value && i < call->args.size(); i++) {
+        if (callee->params[i].type.rfind("Channel<", 0) == 0 &&
+            !dynamic_cast<const VariableRef*>(call->args[i].get())) {
+            by_value = false;
+        }
+    }
+
+    if (!by_value) {
+        string call_code = emit(state, *spawn.call);
+
+        string out = "bishop::rt::spawn([&]() {\n";
+        out += "\t\t" + call_code + ";\n";
+        out += "\t})";
+
+        return out;
+    }
+
+    vector<string> captures;
+    vector<string> args;
+
+    for (size_t i = 0; i < call->args.size(); i++) {
+        string name = "_go_arg" + to_string(i);
+        string value = emit(state, *call->args[i]);
+
+        if (callee->params[i].type.rfind("Channel<", 0) == 0) {
+            captures.push_back(fmt::format("&{} = {}", name, value));
+            args.push_back(name);
+        } else {
+            captures.push_back(fmt::format("{} = {}", name, value));
+            args.push_back("std::move(" + name + ")");
+        }
+    }
+
+    string func_name = call->name;
+    size_t dot_pos = func_name.find('.');
+
+    if (dot_pos != string::npos) {
+        func_name = func_name.substr(0, dot_pos) + "::" + func_name.substr(dot_pos + 1);
+    }
 
-    string out = "bishop::rt::spawn([&]() {\n";
-    out += "\t\t" + call_code + ";\n";
+    string out = fmt::format("bishop::rt::spawn([{}]() mutable {{\n", fmt::join(captures, ", "));
+    out += "\t\t" + function_call(func_name, args) + ";\n";
     out += "\t})";
 
     return out;
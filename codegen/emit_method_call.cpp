@@ -42,9 +42,15 @@ string emit_method_call(CodeGenState& state, const MethodCall& call) {
         }
     }
 
-    // Handle channel methods - direct calls on bishop::rt::Channel
+    // Handle channel methods - direct calls on bishop::rt::Channel.
+    // A value that is not used again is moved into the channel.
     if (call.method_name == "send") {
         string val = args.empty() ? "" : args[0];
+
+        if (state.moved_sends.count(&call)) {
+            val = "std::move(" + val + ")";
+        }
+
         return emit(state, *call.object) + ".send(" + val + ")";
     }
 
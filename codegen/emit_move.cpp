@@ -0,0 +1,241 @@
+/**
+ * @file emit_move.cpp
+ * @brief Last-use analysis for moving values into channels.
+ *
+ * A statement-level ch.send(x) whose variable x is never read again can
+ * hand x's storage to the channel with std::move instead of copying it.
+ * The analysis is a backward liveness pass over each function body. It is
+ * conservative: anything it cannot prove dead is copied as before.
+ */
+
+#include "codegen.hpp"
+
+using namespace std;
+
+namespace codegen {
+
+static void collect_uses(const ASTNode& node, set<string>& uses, set<string>* pinned = nullptr);
+
+static void collect_uses(const vector<unique_ptr<ASTNode>>& nodes, set<string>& uses, set<string>* pinned = nullptr) {
+    for (const auto& node : nodes) {
+        if (node) {
+            collect_uses(*node, uses, pinned);
+        }
+    }
+}
+
+static void collect_uses(const unique_ptr<ASTNode>& node, set<string>& uses, set<string>* pinned = nullptr) {
+    if (node) {
+        collect_uses(*node, uses, pinned);
+    }
+}
+
+/**
+ * Adds every variable name read anywhere inside node to uses. Names that
+ * escape by reference, through a go spawn's [&] capture or &x, may be
+ * read at any later point and are also added to pinned.
+ */
+static void collect_uses(const ASTNode& node, set<string>& uses, set<string>* pinned) {
+    if (auto* ref = dynamic_cast<const VariableRef*>(&node)) {
+        uses.insert(ref->name);
+    } else if (auto* bin = dynamic_cast<const BinaryExpr*>(&node)) {
+        collect_uses(bin->left, uses, pinned);
+        collect_uses(bin->right, uses, pinned);
+    } else if (auto* is_none = dynamic_cast<const IsNone*>(&node)) {
+        collect_uses(is_none->value, uses, pinned);
+    } else if (auto* not_expr = dynamic_cast<const NotExpr*>(&node)) {
+        collect_uses(not_expr->value, uses, pinned);
+    } else if (auto* spawn = dynamic_cast<const GoSpawn*>(&node)) {
+        collect_uses(spawn->call, uses, pinned);
+
+        if (pinned) {
+            collect_uses(spawn->call, *pinned);
+        }
+    } else if (auto* paren = dynamic_cast<const ParenExpr*>(&node)) {
+        collect_uses(paren->value, uses, pinned);
+    } else if (auto* addr = dynamic_cast<const AddressOf*>(&node)) {
+        collect_uses(addr->value, uses, pinned);
+
+        if (pinned) {
+            collect_uses(addr->value, *pinned);
+        }
+    } else if (auto* channel = dynamic_cast<const ChannelCreate*>(&node)) {
+        collect_uses(channel->capacity, uses, pinned);
+    } else if (auto* list = dynamic_cast<const ListLiteral*>(&node)) {
+        collect_uses(list->elements, uses, pinned);
+    } else if (auto* call = dynamic_cast<const FunctionCall*>(&node)) {
+        collect_uses(call->args, uses, pinned);
+    } else if (auto* call = dynamic_cast<const MethodCall*>(&node)) {
+        collect_uses(call->object, uses, pinned);
+        collect_uses(call->args, uses, pinned);
+    } else if (auto* access = dynamic_cast<const FieldAccess*>(&node)) {
+        collect_uses(access->object, uses, pinned);
+    } else if (auto* lit = dynamic_cast<const StructLiteral*>(&node)) {
+        for (const auto& [name, value] : lit->field_values) {
+            collect_uses(value, uses, pinned);
+        }
+    } else if (auto* decl = dynamic_cast<const VariableDecl*>(&node)) {
+        collect_uses(decl->value, uses, pinned);
+    } else if (auto* assign = dynamic_cast<const Assignment*>(&node)) {
+        uses.insert(assign->name);
+        collect_uses(assign->value, uses, pinned);
+    } else if (auto* fa = dynamic_cast<const FieldAssignment*>(&node)) {
+        collect_uses(fa->object, uses, pinned);
+        collect_uses(fa->value, uses, pinned);
+    } else if (auto* ret = dynamic_cast<const ReturnStmt*>(&node)) {
+        collect_uses(ret->value, uses, pinned);
+    } else if (auto* fail = dynamic_cast<const FailStmt*>(&node)) {
+        collect_uses(fail->value, uses, pinned);
+    } else if (auto* or_return = dynamic_cast<const OrReturn*>(&node)) {
+        collect_uses(or_return->value, uses, pinned);
+    } else if (auto* or_fail = dynamic_cast<const OrFail*>(&node)) {
+        collect_uses(or_fail->error_expr, uses, pinned);
+    } else if (auto* or_block = dynamic_cast<const OrBlock*>(&node)) {
+        collect_uses(or_block->body, uses, pinned);
+    } else if (auto* or_match = dynamic_cast<const OrMatch*>(&node)) {
+        for (const auto& arm : or_match->arms) {
+            collect_uses(arm.body, uses, pinned);
+        }
+    } else if (auto* def = dynamic_cast<const DefaultExpr*>(&node)) {
+        collect_uses(def->expr, uses, pinned);
+        collect_uses(def->fallback, uses, pinned);
+    } else if (auto* or_expr = dynamic_cast<const OrExpr*>(&node)) {
+        collect_uses(or_expr->expr, uses, pinned);
+        collect_uses(or_expr->handler, uses, pinned);
+    } else if (auto* with = dynamic_cast<const WithStmt*>(&node)) {
+        collect_uses(with->resource, uses, pinned);
+        collect_uses(with->body, uses, pinned);
+    } else if (auto* if_stmt = dynamic_cast<const IfStmt*>(&node)) {
+        collect_uses(if_stmt->condition, uses, pinned);
+        collect_uses(if_stmt->then_body, uses, pinned);
+        collect_uses(if_stmt->else_body, uses, pinned);
+    } else if (auto* while_stmt = dynamic_cast<const WhileStmt*>(&node)) {
+        collect_uses(while_stmt->condition, uses, pinned);
+        collect_uses(while_stmt->body, uses, pinned);
+    } else if (auto* for_stmt = dynamic_cast<const ForStmt*>(&node)) {
+        collect_uses(for_stmt->range_start, uses, pinned);
+        collect_uses(for_stmt->range_end, uses, pinned);
+        collect_uses(for_stmt->iterable, uses, pinned);
+        collect_uses(for_stmt->body, uses, pinned);
+    } else if (auto* select = dynamic_cast<const SelectStmt*>(&node)) {
+        for (const auto& c : select->cases) {
+            collect_uses(c->channel, uses, pinned);
+            collect_uses(c->send_value, uses, pinned);
+            collect_uses(c->body, uses, pinned);
+        }
+    }
+}
+
+/**
+ * Returns every variable name read anywhere inside node.
+ */
+set<string> variables_read(const ASTNode& node) {
+    set<string> uses;
+    collect_uses(node, uses);
+    return uses;
+}
+
+static void mark_block(CodeGenState& state, const vector<unique_ptr<ASTNode>>& body,
+                       const set<string>& live_out, const set<string>& pinned);
+
+/**
+ * Marks movable sends inside a loop body. A variable is live at the end of
+ * an iteration if the loop header or the next iteration reads it before
+ * redeclaring it.
+ */
+static void mark_loop(CodeGenState& state, const vector<unique_ptr<ASTNode>>& body,
+                      const set<string>& header_uses, const set<string>& live_out,
+                      const set<string>& pinned) {
+    set<string> live_in;
+
+    for (auto it = body.rbegin(); it != body.rend(); ++it) {
+        if (auto* decl = dynamic_cast<const VariableDecl*>(it->get())) {
+            live_in.erase(decl->name);
+        }
+
+        collect_uses(**it, live_in);
+    }
+
+    set<string> live_end = live_out;
+    live_end.insert(header_uses.begin(), header_uses.end());
+    live_end.insert(live_in.begin(), live_in.end());
+
+    mark_block(state, body, live_end, pinned);
+}
+
+/**
+ * Walks a statement list backwards, recording every ch.send(x) where x is
+ * dead afterwards. Declarations only end the liveness of reads that come
+ * later in the same block, never of names live past it, so a shadowed
+ * outer variable is never mistaken for dead.
+ */
+static void mark_block(CodeGenState& state, const vector<unique_ptr<ASTNode>>& body,
+                       const set<string>& live_out, const set<string>& pinned) {
+    set<string> local;
+
+    for (auto it = body.rbegin(); it != body.rend(); ++it) {
+        const ASTNode& stmt = **it;
+
+        set<string> live = live_out;
+        live.insert(local.begin(), local.end());
+
+        if (auto* call = dynamic_cast<const MethodCall*>(&stmt)) {
+            if (call->method_name == "send" && call->args.size() == 1 &&
+                call->object_type.rfind("Channel<", 0) == 0) {
+                auto* ref = dynamic_cast<const VariableRef*>(call->args[0].get());
+                set<string> object_uses;
+                collect_uses(call->object, object_uses);
+
+                if (ref && ref->name != "self" && !live.count(ref->name) &&
+                    !pinned.count(ref->name) && !object_uses.count(ref->name)) {
+                    state.moved_sends.insert(call);
+                }
+            }
+        } else if (auto* with = dynamic_cast<const WithStmt*>(&stmt)) {
+            mark_block(state, with->body, live, pinned);
+        } else if (auto* if_stmt = dynamic_cast<const IfStmt*>(&stmt)) {
+            mark_block(state, if_stmt->then_body, live, pinned);
+            mark_block(state, if_stmt->else_body, live, pinned);
+        } else if (auto* while_stmt = dynamic_cast<const WhileStmt*>(&stmt)) {
+            set<string> header;
+            collect_uses(while_stmt->condition, header);
+            mark_loop(state, while_stmt->body, header, live, pinned);
+        } else if (auto* for_stmt = dynamic_cast<const ForStmt*>(&stmt)) {
+            // The range end is re-evaluated every iteration and a foreach
+            // variable aliases an element of the collection
+            set<string> header;
+            collect_uses(for_stmt->range_start, header);
+            collect_uses(for_stmt->range_end, header);
+            collect_uses(for_stmt->iterable, header);
+
+            if (for_stmt->kind == ForLoopKind::Foreach) {
+                header.insert(for_stmt->loop_var);
+            }
+
+            mark_loop(state, for_stmt->body, header, live, pinned);
+        } else if (auto* select = dynamic_cast<const SelectStmt*>(&stmt)) {
+            for (const auto& c : select->cases) {
+                mark_block(state, c->body, live, pinned);
+            }
+        }
+
+        if (auto* decl = dynamic_cast<const VariableDecl*>(&stmt)) {
+            local.erase(decl->name);
+        }
+
+        collect_uses(stmt, local);
+    }
+}
+
+/**
+ * Records in state.moved_sends every send in a function body whose value
+ * can be moved into the channel.
+ */
+void collect_moved_sends(CodeGenState& state, const vector<unique_ptr<ASTNode>>& body) {
+    set<string> uses;
+    set<string> pinned;
+    collect_uses(body, uses, &pinned);
+    mark_block(state, body, {}, pinned);
+}
+
+} // namespace codegen
@@ -0,0 +1,219 @@
+/**
+ * @file emit_routes.cpp
+ * @brief Compile-time route dispatch for http.App.
+ *
+ * Most apps declare an App, register literal paths with named handler
+ * functions, then call listen(). When that is all an App is used for, its
+ * declaration and registrations are dropped and listen() becomes
+ * http::serve() with a generated dispatcher: a switch on the path length,
+ * then a string comparison, then a direct call to the handler. There is
+ * no route table and no std::function call at run time. Any other use of
+ * the App, or a path with a :param or * segment, keeps the runtime router.
+ *
+ * Middleware added with app.use(named_function) are folded too. Each is a
+ * template over the next step (see http::Next), instantiated here with
+ * the lambda for the rest of the chain, so the request passes by
+ * reference through direct calls down to the handler. The handler gets a
+ * copy, since middleware may read the request after it returns.
+ */
+
+#include "codegen.hpp"
+#include <fmt/format.h>
+#include <optional>
+
+using namespace std;
+
+namespace codegen {
+
+/**
+ * Returns the route for app.get/app.post(literal, handler), or nullopt if
+ * the call is not a static registration on the named variable.
+ */
+static optional<StaticRoute> static_route(const MethodCall& call, const string& app) {
+    auto* object = dynamic_cast<const VariableRef*>(call.object.get());
+
+    if (!object || object->name != app || call.args.size() != 2 ||
+        (call.method_name != "get" && call.method_name != "post")) {
+        return nullopt;
+    }
+
+    auto* path = dynamic_cast<const StringLiteral*>(call.args[0].get());
+    auto* handler = dynamic_cast<const FunctionRef*>(call.args[1].get());
+
+    // Escaped paths are left to the runtime router, since the switch needs
+    // the literal's length
+    if (!path || !handler || path->value.find_first_of(":*?\\") != string::npos) {
+        return nullopt;
+    }
+
+    string method = call.method_name == "get" ? "GET" : "POST";
+    return StaticRoute{method, path->value, emit_function_ref(*handler)};
+}
+
+/**
+ * Returns the emitted function for app.use(middleware), or nullopt if the
+ * call is not a use() of a named function on the named variable.
+ */
+static optional<string> static_middleware(const MethodCall& call, const string& app) {
+    auto* object = dynamic_cast<const VariableRef*>(call.object.get());
+
+    if (!object || object->name != app || call.method_name != "use" || call.args.size() != 1) {
+        return nullopt;
+    }
+
+    auto* middleware = dynamic_cast<const FunctionRef*>(call.args[0].get());
+
+    if (!middleware) {
+        return nullopt;
+    }
+
+    return emit_function_ref(*middleware);
+}
+
+/**
+ * Tries to fold the App declared by decl at body[start] into a static
+ * dispatcher. Every later statement that mentions the App must be a static
+ * registration, a use() of a named middleware, or the single, final
+ * listen() call.
+ */
+static void fold_app(CodeGenState& state, const vector<unique_ptr<ASTNode>>& body, size_t start) {
+    auto* decl = static_cast<const VariableDecl*>(body[start].get());
+    vector<const ASTNode*> folded = {decl};
+    StaticApp app;
+    const MethodCall* listen = nullptr;
+
+    for (size_t i = start + 1; i < body.size(); i++) {
+        if (!variables_read(*body[i]).count(decl->name)) {
+            continue;
+        }
+
+        auto* call = dynamic_cast<const MethodCall*>(body[i].get());
+
+        if (!call || listen) {
+            return;
+        }
+
+        if (call->method_name == "listen" && call->args.size() == 1 &&
+            !variables_read(*call->args[0]).count(decl->name)) {
+            listen = call;
+            continue;
+        }
+
+        if (optional<string> middleware = static_middleware(*call, decl->name)) {
+            app.middleware.push_back(*middleware);
+            folded.push_back(call);
+            continue;
+        }
+
+        optional<StaticRoute> route = static_route(*call, decl->name);
+
+        if (!route) {
+            return;
+        }
+
+        app.routes.push_back(*route);
+        folded.push_back(call);
+    }
+
+    if (!listen) {
+        return;
+    }
+
+    state.static_route_stmts.insert(folded.begin(), folded.end());
+    state.static_apps[listen] = move(app);
+}
+
+void collect_static_routes(CodeGenState& state, const vector<unique_ptr<ASTNode>>& body) {
+    for (size_t i = 0; i < body.size(); i++) {
+        auto* decl = dynamic_cast<const VariableDecl*>(body[i].get());
+        auto* lit = decl ? dynamic_cast<const StructLiteral*>(decl->value.get()) : nullptr;
+
+        if (lit && lit->struct_name == "http.App" && lit->field_values.empty()) {
+            fold_app(state, body, i);
+        }
+    }
+}
+
+/**
+ * Emits the switch that matches a request to its route, at the given
+ * indent. The first registration of a method and path wins, as with the
+ * runtime router. With move_request set the handler takes req over;
+ * otherwise it gets a copy.
+ */
+static string route_switch(const vector<StaticRoute>& routes, const string& indent, bool move_request) {
+    map<size_t, map<string, vector<const StaticRoute*>>> by_length;
+
+    for (const auto& route : routes) {
+        auto& methods = by_length[route.path.size()][route.path];
+        bool seen = false;
+
+        for (const StaticRoute* r : methods) {
+            seen = seen || r->method == route.method;
+        }
+
+        if (!seen) {
+            methods.push_back(&route);
+        }
+    }
+
+    string out = indent + "std::string_view path = http::route_path(req);\n\n";
+    out += indent + "switch (path.size()) {\n";
+
+    for (const auto& [length, paths] : by_length) {
+        out += fmt::format("{}case {}:\n", indent, length);
+
+        for (const auto& [path, methods] : paths) {
+            out += fmt::format("{}\tif (path == \"{}\") {{\n", indent, path);
+
+            for (const StaticRoute* r : methods) {
+                out += fmt::format("{}\t\tif (req.method == \"{}\") return {}({});\n",
+                                   indent, r->method, r->handler, move_request ? "std::move(req)" : "req");
+            }
+
+            out += indent + "\t}\n";
+        }
+
+        out += indent + "\tbreak;\n";
+    }
+
+    out += indent + "}\n\n";
+    out += indent + "return http::not_found();\n";
+    return out;
+}
+
+/**
+ * Emits http::serve(port, dispatcher) for a folded App's listen() call.
+ * With middleware, the route switch becomes the innermost step of the
+ * chain, and each middleware is called with the step inside it.
+ */
+string emit_static_dispatch(CodeGenState& state, const MethodCall& listen, const StaticApp& app) {
+    string out = fmt::format("http::serve({}, [](http::Request req) -> http::Response {{\n",
+                             emit(state, *listen.args[0]));
+
+    if (app.middleware.empty()) {
+        out += route_switch(app.routes, "\t\t", true);
+        out += "\t})";
+        return out;
+    }
+
+    out += "\t\tauto step_0 = [](http::Request& req) -> http::Response {\n";
+    out += route_switch(app.routes, "\t\t\t", false);
+    out += "\t\t};\n";
+
+    // Innermost middleware first, each wrapping the step before it
+    size_t step = 0;
+
+    for (size_t i = app.middleware.size() - 1; i > 0; i--) {
+        out += fmt::format("\t\tauto step_{} = [&](http::Request& req) -> http::Response {{ "
+                           "return {}(req, http::Next<decltype(step_{})>{{step_{}}}); }};\n",
+                           step + 1, app.middleware[i], step, step);
+        step++;
+    }
+
+    out += fmt::format("\n\t\treturn {}(req, http::Next<decltype(step_{})>{{step_{}}});\n",
+                       app.middleware[0], step, step);
+    out += "\t})";
+    return out;
+}
+
+} // namespace codegen
@@ -11,12 +11,23 @@ using namespace std;
 namespace codegen {
 
 /**
- * Generates C++ for a select statement using polling with stackful coroutines.
+ * Generates C++ for a select statement. The fiber registers with every
+ * case's channel, then alternates between trying each case and parking
+ * until one of the channels signals that data arrived.
  */
 string generate_select(CodeGenState& state, const SelectStmt& stmt) {
     string out;
 
-    // Generate a polling loop that checks each channel
+    out += "{\n";
+    out += "bishop::rt::Select _select;\n";
+
+    for (const auto& c : stmt.cases) {
+        if (c->operation == "recv") {
+            out += "_select.watch(" + emit(state, *c->channel) + ");\n";
+        }
+    }
+
+    // Try each channel, park only when all of them are empty
     out += "while (true) {\n";
 
     for (const auto& c : stmt.cases) {
@@ -41,8 +52,8 @@ string generate_select(CodeGenState& state, const SelectStmt& stmt) {
         }
     }
 
-    // Yield to let other fibers run
-    out += "\tboost::this_fiber::yield();\n";
+    out += "\t_select.wait();\n";
+    out += "}\n";
     out += "}\n";
 
     return out;
@@ -19,6 +19,11 @@ namespace codegen {
  * if/while statements, method calls, field assignments, and other statements.
  */
 string generate_statement(CodeGenState& state, const ASTNode& node) {
+    // Folded into a compile-time route dispatcher (see emit_routes.cpp)
+    if (state.static_route_stmts.count(&node)) {
+        return "";
+    }
+
     if (auto* call = dynamic_cast<const FunctionCall*>(&node)) {
         if (call->name == "print") {
             vector<string> args;
@@ -42,31 +47,7 @@ string generate_statement(CodeGenState& state, const ASTNode& node) {
         auto ext_it = state.extern_functions.find(call->name);
 
         if (ext_it != state.extern_functions.end()) {
-            // Extern function - convert string args to const char* with .c_str()
-            const ExternFunctionDef* ext = ext_it->second;
-            vector<string> args;
-
-            for (size_t i = 0; i < call->args.size(); i++) {
-                string arg_code = emit(state, *call->args[i]);
-
-                // If param type is cstr, convert std::string to const char*
-                if (i < ext->params.size() && ext->params[i].type == "cstr") {
-                    // Wrap the argument with .c_str() call
-                    // Need to handle string literals specially
-                    if (auto* str_lit = dynamic_cast<const StringLiteral*>(call->args[i].get())) {
-                        // String literal - just emit the raw string for C function
-                        (void)str_lit;
-                        args.push_back(arg_code + ".c_str()");
-                    } else {
-                        // Variable or expression - needs .c_str()
-                        args.push_back("(" + arg_code + ").c_str()");
-                    }
-                } else {
-                    args.push_back(arg_code);
-                }
-            }
-
-            return function_call(call->name, args) + ";";
+            return extern_call(state, *call, *ext_it->second) + ";";
         }
 
         vector<string> args;
@@ -148,6 +129,12 @@ string generate_statement(CodeGenState& state, const ASTNode& node) {
     }
 
     if (auto* call = dynamic_cast<const MethodCall*>(&node)) {
+        auto app = state.static_apps.find(call);
+
+        if (app != state.static_apps.end()) {
+            return emit_static_dispatch(state, *call, app->second) + ";";
+        }
+
         return emit(state, node) + ";";
     }
 
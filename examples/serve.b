@@ -4,7 +4,6 @@
 // Serves files from the current directory
 
 import http;
-import fs;
 
 fn handle(http.Request req) -> http.Response {
     path := "." + req.path;
@@ -13,16 +12,7 @@ fn handle(http.Request req) -> http.Response {
         path = "./index.html";
     }
 
-    if !fs.exists(path) {
-        return http.not_found();
-    }
-
-    if fs.is_dir(path) {
-        return http.not_found();
-    }
-
-    content := fs.read_file(path);
-    return http.text(content);
+    return http.file(path);
 }
 
 fn main() {
@@ -3,9 +3,10 @@
  * @brief Entry point for the Bishop compiler.
  *
  * Provides the main() function and CLI handling for the Bishop compiler.
- * Supports two modes:
+ * Supports these modes:
  *   - bishop <source.b>     : Transpile to C++ and output to stdout
  *   - bishop test <path>    : Run tests on .b files, compiling and executing them
+ *   - bishop bench-http     : Start an HTTP server and load test it (tools/bench_http.cpp)
  */
 
 #include <iostream>
@@ -24,6 +25,7 @@
 #include "typechecker/typechecker.hpp"
 #include "project/project.hpp"
 #include "project/module.hpp"
+#include "tools/bench_http.hpp"
 
 using namespace std;
 namespace fs = filesystem;
@@ -106,6 +108,7 @@ string build_link_cmd(const TranspileResult& result, const string& exe_output,
     if (result.uses_http) {
         cmd += " -lbishop_http_runtime";
         cmd += " -lllhttp";
+        cmd += " -lz";
     }
 
     // Add extern library flags (skip "c" as libc is implicit)
@@ -224,6 +227,10 @@ TranspileResult transpile(const string& source, const string& filename, bool tes
     // Generate code with imports
     CodeGen codegen;
 
+    if (config) {
+        codegen.runtime = config->runtime;
+    }
+
     if (imports.empty()) {
         result.cpp_code = codegen.generate(ast, test_mode);
     } else {
@@ -481,44 +488,56 @@ int init_project(const string& project_name) {
 }
 
 /**
- * Compiles and runs a bishop source file or project directory.
+ * Resolves a source file or project directory to the file to compile and
+ * the default executable name. A directory needs a bishop.toml with an
+ * entry field. Prints an error and returns false on failure.
  */
-int run_file(const string& path) {
-    string filename;
-
-    if (fs::is_directory(path)) {
-        fs::path dir_path = fs::absolute(path);
-        fs::path toml_path = dir_path / "bishop.toml";
+bool resolve_entry(const string& path, string& filename, string& exe_name) {
+    if (!fs::is_directory(path)) {
+        filename = path;
+        exe_name = fs::path(path).stem().string();
+        return true;
+    }
 
-        if (!fs::exists(toml_path)) {
-            cerr << "Error: No bishop.toml found in " << path << endl;
-            return 1;
-        }
+    fs::path dir_path = fs::absolute(path);
+    fs::path toml_path = dir_path / "bishop.toml";
 
-        auto config = parse_init_file(toml_path);
+    if (!fs::exists(toml_path)) {
+        cerr << "Error: No bishop.toml found in " << path << endl;
+        return false;
+    }
 
-        if (!config) {
-            cerr << "Error: Could not parse bishop.toml" << endl;
-            return 1;
-        }
+    auto config = parse_init_file(toml_path);
 
-        if (!config->entry) {
-            cerr << "Error: No entry field in bishop.toml" << endl;
-            return 1;
-        }
+    if (!config) {
+        cerr << "Error: Could not parse bishop.toml" << endl;
+        return false;
+    }
 
-        fs::path entry_path = dir_path / *config->entry;
+    if (!config->entry) {
+        cerr << "Error: No entry field in bishop.toml" << endl;
+        return false;
+    }
 
-        if (!fs::exists(entry_path)) {
-            cerr << "Error: Entry file not found: " << *config->entry << endl;
-            return 1;
-        }
+    fs::path entry_path = dir_path / *config->entry;
 
-        filename = entry_path.string();
-    } else {
-        filename = path;
+    if (!fs::exists(entry_path)) {
+        cerr << "Error: Entry file not found: " << *config->entry << endl;
+        return false;
     }
 
+    filename = entry_path.string();
+    exe_name = config->name;
+    return true;
+}
+
+/**
+ * Transpiles, compiles and links a bishop source file into exe_file.
+ * Intermediate files are tmp_stem + ".cpp" and ".o".
+ * Returns 0 on success, 1 after printing an error.
+ */
+int compile_program(const string& filename, const string& tmp_stem,
+                    const string& exe_file, bool static_link) {
     string source = read_file(filename);
 
     if (source.empty()) {
@@ -531,11 +550,8 @@ int run_file(const string& path) {
         return 1;
     }
 
-    // Write to temp file
-    string cpp_file = "/tmp/bishop_run.cpp";
-    string obj_file = "/tmp/bishop_run.o";
-    string exe_file = "/tmp/bishop_run";
-
+    string cpp_file = tmp_stem + ".cpp";
+    string obj_file = tmp_stem + ".o";
     ofstream out(cpp_file);
 
     if (!out) {
@@ -554,102 +570,142 @@ int run_file(const string& path) {
         return 1;
     }
 
-    // Link
-    string link_cmd = build_link_cmd(result, exe_file, obj_file);
+    string link_cmd = build_link_cmd(result, exe_file, obj_file, static_link);
 
     if (system(link_cmd.c_str()) != 0) {
         cerr << "Link failed" << endl;
         return 1;
     }
 
-    // Run (static linking, no LD_LIBRARY_PATH needed)
-    return system(exe_file.c_str());
+    return 0;
 }
 
 /**
- * Builds a bishop source file to an executable.
- * If a directory is provided, looks for bishop.toml with entry field.
+ * Compiles and runs a bishop source file or project directory.
  */
-int build_file(const string& path) {
+int run_file(const string& path) {
     string filename;
     string exe_name;
 
-    if (fs::is_directory(path)) {
-        fs::path dir_path = fs::absolute(path);
-        fs::path toml_path = dir_path / "bishop.toml";
+    if (!resolve_entry(path, filename, exe_name)) {
+        return 1;
+    }
 
-        if (!fs::exists(toml_path)) {
-            cerr << "Error: No bishop.toml found in " << path << endl;
-            return 1;
-        }
+    string exe_file = "/tmp/bishop_run";
 
-        auto config = parse_init_file(toml_path);
+    if (compile_program(filename, "/tmp/bishop_run", exe_file, false) != 0) {
+        return 1;
+    }
 
-        if (!config) {
-            cerr << "Error: Could not parse bishop.toml" << endl;
-            return 1;
-        }
+    return system(exe_file.c_str());
+}
 
-        if (!config->entry) {
-            cerr << "Error: No entry field in bishop.toml" << endl;
-            return 1;
-        }
+/**
+ * Builds a bishop source file to an executable.
+ * If a directory is provided, looks for bishop.toml with entry field.
+ */
+int build_file(const string& path) {
+    string filename;
+    string exe_name;
 
-        fs::path entry_path = dir_path / *config->entry;
+    if (!resolve_entry(path, filename, exe_name)) {
+        return 1;
+    }
+
+    // Link with static boost for standalone binary
+    return compile_program(filename, "/tmp/bishop_build", exe_name, true);
+}
 
-        if (!fs::exists(entry_path)) {
-            cerr << "Error: Entry file not found: " << *config->entry << endl;
+/**
+ * Benchmarks an HTTP server with the built-in load generator.
+ *
+ *   bishop bench-http [<file|dir|binary>] [-t threads] [-c connections]
+ *                     [-p pipeline] [-d seconds] [--host addr] [--port n]
+ *                     [--path /x] [--no-keep-alive]
+ *
+ * A .b file or project directory is built and started, a binary is
+ * started as is, and with no program an already running server is
+ * driven. A started server is stopped once the report is printed.
+ */
+int bench_http(int argc, char* argv[]) {
+    bench::Options opts;
+    opts.threads = static_cast<int>(max(1u, thread::hardware_concurrency() / 2));
+    string program;
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--no-keep-alive") {
+            opts.keep_alive = false;
+        } else if ((arg == "-t" || arg == "--threads") && has_value) {
+            opts.threads = atoi(argv[++i]);
+        } else if ((arg == "-c" || arg == "--connections") && has_value) {
+            opts.connections = atoi(argv[++i]);
+        } else if ((arg == "-p" || arg == "--pipeline") && has_value) {
+            opts.pipeline = atoi(argv[++i]);
+        } else if ((arg == "-d" || arg == "--duration") && has_value) {
+            opts.duration = atof(argv[++i]);
+        } else if (arg == "--host" && has_value) {
+            opts.host = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            opts.port = atoi(argv[++i]);
+        } else if (arg == "--path" && has_value) {
+            opts.path = argv[++i];
+        } else if (arg[0] != '-' && program.empty()) {
+            program = arg;
+        } else {
+            cerr << "Error: Unknown bench-http option: " << arg << endl;
             return 1;
         }
-
-        filename = entry_path.string();
-        exe_name = config->name;
-    } else {
-        filename = path;
-        exe_name = fs::path(path).stem().string();
     }
 
-    string source = read_file(filename);
-
-    if (source.empty()) {
+    if (opts.threads < 1 || opts.connections < 1 || opts.pipeline < 1 || opts.duration <= 0) {
+        cerr << "Error: threads, connections, pipeline and duration must be positive" << endl;
         return 1;
     }
 
-    TranspileResult result = transpile(source, filename, false);
+    opts.threads = min(opts.threads, opts.connections);
+    pid_t server = -1;
 
-    if (result.cpp_code.empty()) {
-        return 1;
-    }
+    if (!program.empty()) {
+        string exe_file = program;
 
-    string cpp_file = "/tmp/bishop_build.cpp";
-    string obj_file = "/tmp/bishop_build.o";
-    ofstream out(cpp_file);
+        if (fs::is_directory(program) || fs::path(program).extension() == ".b") {
+            string filename;
+            string exe_name;
+            exe_file = "/tmp/bishop_bench";
 
-    if (!out) {
-        cerr << "Error: Could not create temp file" << endl;
-        return 1;
-    }
+            if (!resolve_entry(program, filename, exe_name) ||
+                compile_program(filename, "/tmp/bishop_bench", exe_file, false) != 0) {
+                return 1;
+            }
+        }
 
-    out << result.cpp_code;
-    out.close();
+        server = bench::start_server(exe_file);
 
-    // Compile (cached)
-    string compile_cmd = build_compile_cmd(obj_file, cpp_file);
+        if (server < 0) {
+            cerr << "Error: Could not start " << exe_file << endl;
+            return 1;
+        }
+    }
 
-    if (system(compile_cmd.c_str()) != 0) {
-        cerr << "Compile failed" << endl;
+    if (!bench::wait_for_port(opts.host, opts.port, server, 10000)) {
+        cerr << "Error: Nothing accepting connections on " << opts.host << ":" << opts.port << endl;
+        bench::stop_server(server);
         return 1;
     }
 
-    // Link with static boost for standalone binary
-    string link_cmd = build_link_cmd(result, exe_name, obj_file, true);
+    cout << "Running " << opts.duration << "s test @ http://" << opts.host << ":" << opts.port << opts.path << endl;
+    cout << "  " << opts.threads << " threads, " << opts.connections << " connections, pipeline "
+         << (opts.keep_alive ? opts.pipeline : 1) << (opts.keep_alive ? ", keep-alive" : ", no keep-alive")
+         << endl << endl;
 
-    if (system(link_cmd.c_str()) != 0) {
-        cerr << "Link failed" << endl;
-        return 1;
-    }
+    bench::Report report = bench::run(opts);
+    bench::print(report, cout);
+    bench::stop_server(server);
 
-    return 0;
+    return report.requests > 0 ? 0 : 1;
 }
 
 /**
@@ -658,6 +714,7 @@ int build_file(const string& path) {
  *   bishop run <file|dir>   - Build and run
  *   bishop test <path>      - Run tests
  *   bishop init <name>      - Initialize project
+ *   bishop bench-http [...] - Load test an HTTP server
  */
 int main(int argc, char* argv[]) {
     if (argc < 2) {
@@ -665,6 +722,7 @@ int main(int argc, char* argv[]) {
         cerr << "       bishop run <file|dir>" << endl;
         cerr << "       bishop test <path>" << endl;
         cerr << "       bishop init <name>" << endl;
+        cerr << "       bishop bench-http [<file|dir|binary>] [-t threads] [-c connections] [-p pipeline] [-d seconds]" << endl;
         return 1;
     }
 
@@ -689,5 +747,9 @@ int main(int argc, char* argv[]) {
         return run_file(argv[2]);
     }
 
+    if (cmd == "bench-http") {
+        return bench_http(argc, argv);
+    }
+
     return build_file(cmd);
 }
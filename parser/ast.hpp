@@ -156,9 +156,10 @@ struct AddressOf : ASTNode {
 // Channels - Concurrent communication primitives
 //------------------------------------------------------------------------------
 
-/** @brief Channel creation: Channel<int>() */
+/** @brief Channel creation: Channel<int>() or Channel<int>(capacity) */
 struct ChannelCreate : ASTNode {
-    string element_type;  ///< Type of elements the channel carries
+    string element_type;            ///< Type of elements the channel carries
+    unique_ptr<ASTNode> capacity;   ///< Buffer size, 0 = unbuffered (null = default)
 };
 
 /** @brief List creation: List<int>() */
@@ -340,6 +341,7 @@ struct ExternFunctionDef : ASTNode {
     vector<FunctionParam> params;         ///< Parameter list with C-compatible types
     string return_type;                   ///< Return type (cint, cstr, void, or empty)
     string library;                       ///< Library to link against ("c", "m", etc.)
+    bool blocking = false;                ///< @extern("lib", blocking): call on the offload pool
     Visibility visibility = Visibility::Public;  ///< Access modifier
     string doc_comment;                   ///< Documentation comment (from ///)
 };
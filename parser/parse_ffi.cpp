@@ -20,7 +20,9 @@ namespace parser {
  * @example
  * @extern("c") fn puts(cstr s) -> cint;
  * @extern("m") fn sqrt(f64 x) -> f64;
- * @note Use C-compatible types: cint, cstr, void
+ * @extern("c", blocking) fn usleep(cint usec) -> cint;
+ * @note Use C-compatible types: cint, cstr, void. Mark calls that block
+ * (disk, network, sleeps) with `blocking` to run them on the offload pool.
  */
 unique_ptr<ExternFunctionDef> parse_extern_function(ParserState& state, const string& library) {
     consume(state, TokenType::FN);
@@ -80,7 +80,7 @@ unique_ptr<Program> parse(ParserState& state) {
         // Collect any doc comments before the definition
         string doc = collect_doc_comments(state);
 
-        // Check for @extern("lib") annotation
+        // Check for @extern("lib") or @extern("lib", blocking) annotation
         if (check(state, TokenType::AT)) {
             size_t at_pos = state.pos;
             advance(state);
@@ -89,9 +89,23 @@ unique_ptr<Program> parse(ParserState& state) {
                 advance(state);
                 consume(state, TokenType::LPAREN);
                 string library = consume(state, TokenType::STRING).value;
+                bool blocking = false;
+
+                if (check(state, TokenType::COMMA)) {
+                    advance(state);
+                    Token flag = consume(state, TokenType::IDENT);
+
+                    if (flag.value != "blocking") {
+                        throw runtime_error("unknown @extern option '" + flag.value + "' at line " + to_string(flag.line));
+                    }
+
+                    blocking = true;
+                }
+
                 consume(state, TokenType::RPAREN);
 
                 auto ext = parse_extern_function(state, library);
+                ext->blocking = blocking;
                 ext->doc_comment = doc;
                 program->externs.push_back(move(ext));
                 continue;
@@ -53,6 +53,24 @@ optional<ProjectConfig> find_project(const fs::path& start_path) {
  * Expects TOML format:
  *   [project]
  *   name = "projectname"
+ *
+ *   [runtime]
+ *   workers = 4
+ *   listeners = 0
+ *   stack_size = 65536
+ *   stack_pool = 1024
+ *   stack_guard = true
+ *   offload_threads = 8
+ *   http_idle_timeout_ms = 30000
+ *   http_body_buffer_bytes = 65536
+ *   http_max_body_bytes = 104857600
+ *   http_max_connections = 10000
+ *   http_header_timeout_ms = 5000
+ *   http_body_timeout_ms = 10000
+ *   http_write_timeout_ms = 10000
+ *   http_max_header_bytes = 16384
+ *   http_compress_min_bytes = 1024
+ *   http_compress_offload_bytes = 262144
  */
 optional<ProjectConfig> parse_init_file(const fs::path& init_file) {
     try {
@@ -75,6 +93,102 @@ optional<ProjectConfig> parse_init_file(const fs::path& init_file) {
             config.entry = *entry;
         }
 
+        auto workers = tbl["runtime"]["workers"].value<int64_t>();
+
+        if (workers) {
+            config.runtime.workers = static_cast<int>(*workers);
+        }
+
+        auto listeners = tbl["runtime"]["listeners"].value<int64_t>();
+
+        if (listeners) {
+            config.runtime.listeners = static_cast<int>(*listeners);
+        }
+
+        auto stack_size = tbl["runtime"]["stack_size"].value<int64_t>();
+
+        if (stack_size) {
+            config.runtime.stack_size = static_cast<int>(*stack_size);
+        }
+
+        auto stack_pool = tbl["runtime"]["stack_pool"].value<int64_t>();
+
+        if (stack_pool) {
+            config.runtime.stack_pool = static_cast<int>(*stack_pool);
+        }
+
+        auto stack_guard = tbl["runtime"]["stack_guard"].value<bool>();
+
+        if (stack_guard) {
+            config.runtime.stack_guard = *stack_guard;
+        }
+
+        auto offload_threads = tbl["runtime"]["offload_threads"].value<int64_t>();
+
+        if (offload_threads) {
+            config.runtime.offload_threads = static_cast<int>(*offload_threads);
+        }
+
+        auto http_idle_timeout_ms = tbl["runtime"]["http_idle_timeout_ms"].value<int64_t>();
+
+        if (http_idle_timeout_ms) {
+            config.runtime.http_idle_timeout_ms = static_cast<int>(*http_idle_timeout_ms);
+        }
+
+        auto http_body_buffer_bytes = tbl["runtime"]["http_body_buffer_bytes"].value<int64_t>();
+
+        if (http_body_buffer_bytes) {
+            config.runtime.http_body_buffer_bytes = static_cast<int>(*http_body_buffer_bytes);
+        }
+
+        auto http_max_body_bytes = tbl["runtime"]["http_max_body_bytes"].value<int64_t>();
+
+        if (http_max_body_bytes) {
+            config.runtime.http_max_body_bytes = static_cast<int>(*http_max_body_bytes);
+        }
+
+        auto http_max_connections = tbl["runtime"]["http_max_connections"].value<int64_t>();
+
+        if (http_max_connections) {
+            config.runtime.http_max_connections = static_cast<int>(*http_max_connections);
+        }
+
+        auto http_header_timeout_ms = tbl["runtime"]["http_header_timeout_ms"].value<int64_t>();
+
+        if (http_header_timeout_ms) {
+            config.runtime.http_header_timeout_ms = static_cast<int>(*http_header_timeout_ms);
+        }
+
+        auto http_body_timeout_ms = tbl["runtime"]["http_body_timeout_ms"].value<int64_t>();
+
+        if (http_body_timeout_ms) {
+            config.runtime.http_body_timeout_ms = static_cast<int>(*http_body_timeout_ms);
+        }
+
+        auto http_write_timeout_ms = tbl["runtime"]["http_write_timeout_ms"].value<int64_t>();
+
+        if (http_write_timeout_ms) {
+            config.runtime.http_write_timeout_ms = static_cast<int>(*http_write_timeout_ms);
+        }
+
+        auto http_max_header_bytes = tbl["runtime"]["http_max_header_bytes"].value<int64_t>();
+
+        if (http_max_header_bytes) {
+            config.runtime.http_max_header_bytes = static_cast<int>(*http_max_header_bytes);
+        }
+
+        auto http_compress_min_bytes = tbl["runtime"]["http_compress_min_bytes"].value<int64_t>();
+
+        if (http_compress_min_bytes) {
+            config.runtime.http_compress_min_bytes = static_cast<int>(*http_compress_min_bytes);
+        }
+
+        auto http_compress_offload_bytes = tbl["runtime"]["http_compress_offload_bytes"].value<int64_t>();
+
+        if (http_compress_offload_bytes) {
+            config.runtime.http_compress_offload_bytes = static_cast<int>(*http_compress_offload_bytes);
+        }
+
         return config;
     } catch (const toml::parse_error&) {
         return nullopt;
@@ -14,6 +14,28 @@
 
 namespace fs = std::filesystem;
 
+/**
+ * @brief Runtime settings from the [runtime] section of bishop.toml
+ */
+struct RuntimeSettings {
+    int workers = 1;       ///< Scheduler threads; 0 = one per CPU core
+    int listeners = 1;     ///< SO_REUSEPORT http listener threads; 0 = one per CPU core
+    int stack_size = 0;    ///< Fiber stack size in bytes; 0 = platform default
+    int stack_pool = 256;  ///< Free fiber stacks kept per thread for reuse
+    bool stack_guard = true;  ///< Guard page below each fiber stack
+    int offload_threads = 4;  ///< Blocking-offload pool threads; 0 = one per CPU core
+    int http_idle_timeout_ms = 5000;  ///< Idle keep-alive HTTP connections close after this; 0 = never
+    int http_body_buffer_bytes = 1 << 20;  ///< Longer HTTP request bodies are streamed, not buffered
+    int http_max_body_bytes = 0;  ///< Longer HTTP request bodies are rejected with 413; 0 = no limit
+    int http_max_connections = 0;  ///< HTTP accepting pauses at this many open connections; 0 = no limit
+    int http_header_timeout_ms = 10000;  ///< An HTTP request head must arrive within this of its first byte; 0 = never
+    int http_body_timeout_ms = 30000;  ///< Each read of an HTTP request body must get data within this; 0 = never
+    int http_write_timeout_ms = 30000;  ///< Each HTTP response write must finish within this; 0 = never
+    int http_max_header_bytes = 64 * 1024;  ///< Longer HTTP request heads close the connection
+    int http_compress_min_bytes = 0;  ///< HTTP response bodies this large are compressed when accepted; 0 = never
+    int http_compress_offload_bytes = 0;  ///< Bodies this large are compressed on the offload pool; 0 = never
+};
+
 /**
  * @brief Project configuration loaded from bishop.toml
  */
@@ -22,6 +44,7 @@ struct ProjectConfig {
     fs::path root;         ///< Absolute path to project root directory
     fs::path init_file;    ///< Path to the bishop.toml file
     std::optional<std::string> entry;  ///< Optional entry point file for building
+    RuntimeSettings runtime;           ///< Settings baked into the generated main()
 };
 
 /**
@@ -38,6 +61,24 @@ std::optional<ProjectConfig> find_project(const fs::path& start_path);
  * Expects TOML-like format:
  *   [project]
  *   name = "projectname"
+ *
+ *   [runtime]
+ *   workers = 4
+ *   listeners = 0
+ *   stack_size = 65536
+ *   stack_pool = 1024
+ *   stack_guard = true
+ *   offload_threads = 8
+ *   http_idle_timeout_ms = 30000
+ *   http_body_buffer_bytes = 65536
+ *   http_max_body_bytes = 104857600
+ *   http_max_connections = 10000
+ *   http_header_timeout_ms = 5000
+ *   http_body_timeout_ms = 10000
+ *   http_write_timeout_ms = 10000
+ *   http_max_header_bytes = 16384
+ *   http_compress_min_bytes = 1024
+ *   http_compress_offload_bytes = 262144
  */
 std::optional<ProjectConfig> parse_init_file(const fs::path& init_file);
 
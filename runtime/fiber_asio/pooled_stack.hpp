@@ -0,0 +1,155 @@
+/**
+ * @file pooled_stack.hpp
+ * @brief Fiber stack allocator that recycles stacks instead of unmapping them.
+ *
+ * Satisfies the Boost.Context StackAllocator concept, so it can be passed
+ * to boost::fibers::fiber with std::allocator_arg.
+ */
+
+#ifndef NOG_FIBER_ASIO_POOLED_STACK_HPP
+#define NOG_FIBER_ASIO_POOLED_STACK_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <boost/context/stack_context.hpp>
+#include <boost/context/stack_traits.hpp>
+
+namespace boost {
+namespace fibers {
+namespace asio {
+
+/**
+ * Stack allocator backed by a per-thread cache of mmap'd stacks.
+ *
+ * A fiber's stack goes back to the cache of whichever thread finishes the
+ * fiber and is handed to the next fiber spawned there, so in steady state
+ * spawning a fiber makes no syscalls. Each cache holds at most pool_limit
+ * stacks; stacks beyond that are unmapped. With guard_page set, the page
+ * below each stack is mapped PROT_NONE so an overflow faults instead of
+ * corrupting the neighbouring mapping.
+ */
+class pooled_stack {
+public:
+    struct settings {
+        std::size_t size = boost::context::stack_traits::default_size();
+        std::size_t pool_limit = 256;
+        bool guard_page = true;
+    };
+
+    /**
+     * Sets the stack size and pool limit for all threads. Must be called
+     * before the first fiber is spawned.
+     */
+    static void configure(settings s) {
+        std::size_t page = page_size();
+        s.size = std::max(s.size, boost::context::stack_traits::minimum_size());
+        s.size = (s.size + page - 1) / page * page;
+        global() = s;
+    }
+
+    boost::context::stack_context allocate() {
+        if (!cache_destroyed()) {
+            std::vector<boost::context::stack_context>& stacks = local_cache().stacks;
+
+            if (!stacks.empty()) {
+                boost::context::stack_context sctx = stacks.back();
+                stacks.pop_back();
+                return sctx;
+            }
+        }
+
+        const settings& s = global();
+        std::size_t guard = s.guard_page ? page_size() : 0;
+        std::size_t total = s.size + guard;
+
+        void* base = ::mmap(nullptr, total, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+
+        if (base == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        if (guard > 0) {
+            ::mprotect(base, guard, PROT_NONE);
+        }
+
+        // Stacks grow down, so the usable top is the end of the mapping
+        boost::context::stack_context sctx;
+        sctx.size = s.size;
+        sctx.sp = static_cast<char*>(base) + total;
+        return sctx;
+    }
+
+    void deallocate(boost::context::stack_context& sctx) noexcept {
+        // Fibers destroyed during thread teardown may outlive the cache
+        if (!cache_destroyed()) {
+            cache& c = local_cache();
+
+            if (c.stacks.size() < global().pool_limit) {
+                c.stacks.push_back(sctx);
+                return;
+            }
+        }
+
+        unmap(sctx);
+    }
+
+private:
+    /**
+     * A thread's free stacks, unmapped when the thread exits.
+     */
+    struct cache {
+        std::vector<boost::context::stack_context> stacks;
+
+        // Reserved up front so deallocate() never allocates
+        cache() {
+            stacks.reserve(global().pool_limit);
+        }
+
+        ~cache() {
+            cache_destroyed() = true;
+
+            for (boost::context::stack_context& sctx : stacks) {
+                unmap(sctx);
+            }
+        }
+    };
+
+    static bool& cache_destroyed() {
+        static thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    static settings& global() {
+        static settings s;
+        return s;
+    }
+
+    static cache& local_cache() {
+        static thread_local cache c;
+        return c;
+    }
+
+    static std::size_t page_size() {
+        static const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        return page;
+    }
+
+    static void unmap(boost::context::stack_context& sctx) noexcept {
+        std::size_t guard = global().guard_page ? page_size() : 0;
+        std::size_t total = sctx.size + guard;
+        ::munmap(static_cast<char*>(sctx.sp) - total, total);
+    }
+};
+
+}  // namespace asio
+}  // namespace fibers
+}  // namespace boost
+
+#endif  // NOG_FIBER_ASIO_POOLED_STACK_HPP
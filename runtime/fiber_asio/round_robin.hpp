@@ -11,6 +11,7 @@
 #ifndef NOG_FIBER_ASIO_ROUND_ROBIN_HPP
 #define NOG_FIBER_ASIO_ROUND_ROBIN_HPP
 
+#include <atomic>
 #include <chrono>
 #include <cstddef>
 #include <memory>
@@ -40,15 +41,23 @@ namespace asio {
  * This scheduler allows fibers to yield during async I/O operations.
  * When a fiber calls an async operation with boost::fibers::asio::yield,
  * it suspends and other fibers can run until the I/O completes.
+ *
+ * The main context drives the io_context. While fibers are ready it parks
+ * on a fiber condition variable so the whole ready batch runs first, then
+ * collects I/O completions with a single non-blocking poll(); it only
+ * blocks in the reactor once nothing is ready. Wakeups from other threads
+ * are coalesced so a burst of them costs one reactor interrupt.
  */
 class round_robin : public algo::algorithm {
 private:
     std::shared_ptr<boost::asio::io_context> io_ctx_;
     boost::asio::steady_timer suspend_timer_;
+    std::chrono::steady_clock::time_point armed_until_{};
     boost::fibers::scheduler::ready_queue_type rqueue_{};
     boost::fibers::mutex mtx_{};
     boost::fibers::condition_variable cnd_{};
     std::size_t counter_{0};
+    std::atomic<bool> notified_{false};
 
 public:
     /**
@@ -87,9 +96,14 @@ public:
         boost::asio::post(*io_ctx_, [this]() mutable {
             while (!io_ctx_->stopped()) {
                 if (has_ready_fibers()) {
-                    while (io_ctx_->poll());
-                    std::unique_lock<boost::fibers::mutex> lk(mtx_);
-                    cnd_.wait(lk);
+                    // Run the ready batch; suspend_until() wakes us once
+                    // the dispatcher finds nothing left to run
+                    {
+                        std::unique_lock<boost::fibers::mutex> lk(mtx_);
+                        cnd_.wait(lk);
+                    }
+
+                    io_ctx_->poll();
                 } else {
                     if (!io_ctx_->run_one()) {
                         break;
@@ -140,12 +154,19 @@ public:
     }
 
     /**
-     * Suspends scheduler until given time point.
+     * Suspends scheduler until given time point. The timer is only
+     * re-armed when the earliest sleeper's deadline changes.
      */
     void suspend_until(std::chrono::steady_clock::time_point const& abs_time) noexcept {
-        if ((std::chrono::steady_clock::time_point::max)() != abs_time) {
+        if ((std::chrono::steady_clock::time_point::max)() != abs_time && armed_until_ != abs_time) {
+            armed_until_ = abs_time;
             suspend_timer_.expires_at(abs_time);
-            suspend_timer_.async_wait([](boost::system::error_code const&) {
+            suspend_timer_.async_wait([this](boost::system::error_code const& ec) {
+                if (ec == boost::asio::error::operation_aborted) {
+                    return;
+                }
+
+                armed_until_ = {};
                 this_fiber::yield();
             });
         }
@@ -154,13 +175,17 @@ public:
     }
 
     /**
-     * Notifies scheduler that a fiber is ready.
+     * Notifies scheduler that a fiber was readied from another thread.
+     * Only one wakeup handler is in flight at a time; it yields the main
+     * context so the dispatcher collects every remotely readied fiber.
      */
     void notify() noexcept {
-        suspend_timer_.async_wait([](boost::system::error_code const&) {
-            this_fiber::yield();
-        });
-        suspend_timer_.expires_at(std::chrono::steady_clock::now());
+        if (!notified_.exchange(true, std::memory_order_acq_rel)) {
+            boost::asio::post(*io_ctx_, [this]() {
+                notified_.store(false, std::memory_order_release);
+                this_fiber::yield();
+            });
+        }
     }
 };
 
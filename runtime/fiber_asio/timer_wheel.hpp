@@ -0,0 +1,197 @@
+/**
+ * @file timer_wheel.hpp
+ * @brief Hashed timing wheel for fiber sleeps and I/O deadlines.
+ */
+
+#ifndef NOG_FIBER_ASIO_TIMER_WHEEL_HPP
+#define NOG_FIBER_ASIO_TIMER_WHEEL_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+namespace boost {
+namespace fibers {
+namespace asio {
+
+/**
+ * Hashed timing wheel owned by one scheduler thread.
+ *
+ * Timers are intrusive list nodes hashed into SLOTS buckets by their
+ * deadline tick, so adding and cancelling a timer are O(1) and allocate
+ * nothing. A single steady_timer on the thread's io_context drives the
+ * wheel: each time it fires, every slot the clock has passed is swept
+ * once and all expired timers in it are fired as one batch. The
+ * steady_timer is only armed while timers are pending.
+ *
+ * Not thread-safe; timers must be added, cancelled and fired on the
+ * owning thread.
+ */
+class timer_wheel {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t SLOTS = 1024;
+    static constexpr std::chrono::milliseconds TICK{1};
+
+    /**
+     * A pending timer. Embed it in the object that waits and set fire,
+     * which is called on the owning thread when the deadline passes.
+     */
+    struct timer {
+        timer* prev = nullptr;
+        timer* next = nullptr;
+        std::uint64_t deadline = 0;    // in ticks since the wheel's origin
+        void (*fire)(timer*) = nullptr;
+
+        bool pending() const { return prev != nullptr; }
+    };
+
+    explicit timer_wheel(std::shared_ptr<boost::asio::io_context> const& io_ctx) :
+        io_ctx_(io_ctx),
+        tick_timer_(*io_ctx_),
+        origin_(clock::now()) {
+        for (timer& head : slots_) {
+            head.prev = &head;
+            head.next = &head;
+        }
+    }
+
+    timer_wheel(timer_wheel const&) = delete;
+    timer_wheel& operator=(timer_wheel const&) = delete;
+
+    /**
+     * Schedules t to fire after delay, rounded up to a whole tick.
+     */
+    void add(timer& t, clock::duration delay) {
+        std::uint64_t now = now_tick();
+        auto ticks = (delay + TICK - clock::duration(1)) / TICK;
+        t.deadline = now + static_cast<std::uint64_t>(ticks > 0 ? ticks : 1);
+
+        timer& head = slots_[t.deadline % SLOTS];
+        t.prev = head.prev;
+        t.next = &head;
+        head.prev->next = &t;
+        head.prev = &t;
+
+        if (count_++ == 0) {
+            // The wheel was idle; nothing is due in the skipped ticks
+            cursor_ = now;
+            arm(t.deadline);
+        } else if (t.deadline < armed_for_) {
+            arm(t.deadline);
+        }
+    }
+
+    /**
+     * Removes a pending timer without firing it. No-op if it already fired.
+     */
+    void cancel(timer& t) noexcept {
+        if (!t.pending()) {
+            return;
+        }
+
+        unlink(t);
+        count_--;
+    }
+
+    /**
+     * Number of timers waiting to fire.
+     */
+    std::size_t size() const noexcept {
+        return count_;
+    }
+
+private:
+    std::shared_ptr<boost::asio::io_context> io_ctx_;
+    boost::asio::steady_timer tick_timer_;
+    clock::time_point origin_;
+    std::array<timer, SLOTS> slots_;   // list sentinels
+    std::size_t count_ = 0;
+    std::uint64_t cursor_ = 0;         // last tick swept
+    std::uint64_t armed_for_ = 0;      // tick the steady_timer fires at
+
+    std::uint64_t now_tick() const {
+        return static_cast<std::uint64_t>((clock::now() - origin_) / TICK);
+    }
+
+    static void unlink(timer& t) noexcept {
+        t.prev->next = t.next;
+        t.next->prev = t.prev;
+        t.prev = nullptr;
+        t.next = nullptr;
+    }
+
+    /**
+     * Arms the steady_timer for the given tick. Re-arming cancels the
+     * previous wait, whose handler then runs with operation_aborted.
+     */
+    void arm(std::uint64_t tick) {
+        armed_for_ = tick;
+        tick_timer_.expires_at(origin_ + tick * TICK);
+        tick_timer_.async_wait([this](boost::system::error_code const& ec) {
+            if (ec != boost::asio::error::operation_aborted) {
+                advance();
+            }
+        });
+    }
+
+    /**
+     * Sweeps every slot between the cursor and now, fires the expired
+     * timers, then re-arms for the next non-empty slot.
+     */
+    void advance() {
+        std::uint64_t now = now_tick();
+        std::uint64_t span = now - cursor_;
+
+        if (span > SLOTS) {
+            span = SLOTS;
+        }
+
+        for (std::uint64_t i = 1; i <= span; i++) {
+            timer& head = slots_[(cursor_ + i) % SLOTS];
+            timer* t = head.next;
+
+            while (t != &head) {
+                timer* next = t->next;
+
+                if (t->deadline <= now) {
+                    unlink(*t);
+                    count_--;
+                    t->fire(t);
+                }
+
+                t = next;
+            }
+        }
+
+        cursor_ = now;
+
+        if (count_ == 0) {
+            armed_for_ = 0;
+            return;
+        }
+
+        // Timers in the next non-empty slot may be whole revolutions away;
+        // waking early for them only costs one extra sweep
+        for (std::uint64_t tick = now + 1; tick <= now + SLOTS; tick++) {
+            timer& head = slots_[tick % SLOTS];
+
+            if (head.next != &head) {
+                arm(tick);
+                return;
+            }
+        }
+    }
+};
+
+}  // namespace asio
+}  // namespace fibers
+}  // namespace boost
+
+#endif  // NOG_FIBER_ASIO_TIMER_WHEEL_HPP
@@ -0,0 +1,326 @@
+/**
+ * @file work_stealing.hpp
+ * @brief Multi-threaded work-stealing fiber scheduler integrated with Boost.Asio.
+ *
+ * Based on boost::fibers::algo::work_stealing by Oliver Kowalke.
+ *
+ * Copyright Oliver Kowalke 2015.
+ * Distributed under the Boost Software License, Version 1.0.
+ */
+
+#ifndef NOG_FIBER_ASIO_WORK_STEALING_HPP
+#define NOG_FIBER_ASIO_WORK_STEALING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/assert.hpp>
+#include <boost/config.hpp>
+
+#include <boost/fiber/algo/algorithm.hpp>
+#include <boost/fiber/context.hpp>
+#include <boost/fiber/detail/context_spinlock_queue.hpp>
+#include <boost/fiber/scheduler.hpp>
+
+#include "yield.hpp"
+
+namespace boost {
+namespace fibers {
+namespace asio {
+
+/**
+ * Work-stealing fiber scheduler with one io_context per worker thread.
+ *
+ * Every worker thread installs its own instance. Ready fibers go to the
+ * local queue; a worker whose queue runs dry steals from a random peer
+ * before blocking in its io_context. Async operations complete on the
+ * io_context that owns the socket, and the woken fiber is handed back to
+ * the scheduler it suspended on, from where idle peers may steal it.
+ *
+ * A fiber that owns sockets or timers on its worker's io_context pins
+ * itself with pin(). Pinned fibers are never detached and wait in a queue
+ * peers cannot steal from, so they only run on the thread that runs the
+ * io_context, and never at the same time as their completion handlers.
+ */
+class work_stealing : public algo::algorithm {
+public:
+    /**
+     * Registry of the schedulers that may steal from one another.
+     * Shared by all workers; slots are filled as worker threads start.
+     */
+    struct pool {
+        explicit pool(std::size_t size) : members(size) {}
+
+        std::vector<std::atomic<work_stealing*>> members;
+        std::atomic<std::size_t> idle{0};
+    };
+
+private:
+    using work_guard_type = boost::asio::executor_work_guard<
+        boost::asio::io_context::executor_type>;
+
+    std::shared_ptr<pool> pool_;
+    std::size_t id_;
+    std::shared_ptr<boost::asio::io_context> io_ctx_;
+    work_guard_type work_;
+    boost::fibers::detail::context_spinlock_queue rqueue_{};            // stealable fibers
+    boost::fibers::scheduler::ready_queue_type pinned_queue_{};         // only this thread's
+    std::unordered_set<context*> pinned_;                               // fibers pinned with pin()
+    bool pinned_turn_{false};
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> notified_{false};
+    bool woken_{false};
+
+    /**
+     * Steals a ready fiber from a random peer, or returns nullptr.
+     */
+    context* steal_from_peer() noexcept {
+        static thread_local std::minstd_rand generator{std::random_device{}()};
+        std::size_t size = pool_->members.size();
+
+        if (size < 2) {
+            return nullptr;
+        }
+
+        std::uniform_int_distribution<std::size_t> distribution{0, size - 1};
+
+        for (std::size_t attempt = 0; attempt < size; ++attempt) {
+            std::size_t id = distribution(generator);
+
+            if (id == id_) {
+                continue;
+            }
+
+            work_stealing* victim = pool_->members[id].load(std::memory_order_acquire);
+
+            if (nullptr == victim) {
+                continue;
+            }
+
+            if (context* ctx = victim->rqueue_.steal()) {
+                return ctx;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Wakes one sleeping peer so it can steal newly readied work.
+     */
+    void wake_idle_peer() noexcept {
+        for (auto& member : pool_->members) {
+            work_stealing* peer = member.load(std::memory_order_acquire);
+
+            if (nullptr != peer && peer != this && peer->sleeping_.load(std::memory_order_seq_cst)) {
+                peer->notify();
+                return;
+            }
+        }
+    }
+
+    /**
+     * Returns true if any peer has fibers this worker could steal. Pinned
+     * contexts never enter rqueue_, so a non-empty one can be stolen from.
+     */
+    bool peers_have_work() const noexcept {
+        for (auto const& member : pool_->members) {
+            work_stealing* peer = member.load(std::memory_order_acquire);
+
+            if (nullptr != peer && peer != this && !peer->rqueue_.empty()) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Pops the next local fiber, taking turns between the pinned queue and
+     * rqueue_ so neither starves the other.
+     */
+    context* pop_local() noexcept {
+        pinned_turn_ = !pinned_turn_;
+
+        if (pinned_turn_ && !pinned_queue_.empty()) {
+            context* ctx = &pinned_queue_.front();
+            pinned_queue_.pop_front();
+            return ctx;
+        }
+
+        if (context* ctx = rqueue_.pop()) {
+            context::active()->attach(ctx);
+            return ctx;
+        }
+
+        if (!pinned_queue_.empty()) {
+            context* ctx = &pinned_queue_.front();
+            pinned_queue_.pop_front();
+            return ctx;
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * The scheduler installed on the calling thread, if it is one of these.
+     */
+    static work_stealing*& local() noexcept {
+        static thread_local work_stealing* instance = nullptr;
+        return instance;
+    }
+
+public:
+    /**
+     * Constructs the scheduler for worker `id` and registers it in the pool.
+     */
+    work_stealing(std::shared_ptr<pool> const& p, std::size_t id,
+                  std::shared_ptr<boost::asio::io_context> const& io_ctx) :
+        pool_(p),
+        id_(id),
+        io_ctx_(io_ctx),
+        work_(io_ctx_->get_executor()) {
+        BOOST_ASSERT(id_ < pool_->members.size());
+        pool_->members[id_].store(this, std::memory_order_release);
+        local() = this;
+    }
+
+    ~work_stealing() override {
+        pool_->members[id_].store(nullptr, std::memory_order_release);
+        local() = nullptr;
+    }
+
+    work_stealing(work_stealing const&) = delete;
+    work_stealing& operator=(work_stealing const&) = delete;
+
+    /**
+     * Keeps the running fiber on this thread until unpin(). Returns false
+     * if it was pinned already, or if the thread does not run this
+     * scheduler and so never moves fibers anyway.
+     */
+    static bool pin() {
+        work_stealing* self = local();
+        return nullptr != self && self->pinned_.insert(context::active()).second;
+    }
+
+    /**
+     * Lets peers steal the running fiber again.
+     */
+    static void unpin() noexcept {
+        if (work_stealing* self = local()) {
+            self->pinned_.erase(context::active());
+        }
+    }
+
+    /**
+     * Called when a fiber becomes ready to run. Unpinned fibers are
+     * detached so whichever worker picks them up can adopt them. Always
+     * runs on this worker's thread: boost hands fibers readied elsewhere
+     * to it through the remote ready queue.
+     */
+    void awakened(context* ctx) noexcept override {
+        BOOST_ASSERT(nullptr != ctx);
+
+        // The main and dispatcher contexts are pinned by boost
+        if (ctx->is_context(boost::fibers::type::pinned_context) || pinned_.count(ctx) > 0) {
+            ctx->ready_link(pinned_queue_);
+            return;
+        }
+
+        ctx->detach();
+        rqueue_.push(ctx);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (pool_->idle.load(std::memory_order_relaxed) > 0) {
+            wake_idle_peer();
+        }
+    }
+
+    /**
+     * Returns the next fiber to run, stealing from a peer if the local
+     * queue is empty.
+     */
+    context* pick_next() noexcept override {
+        context* ctx = pop_local();
+
+        if (nullptr == ctx) {
+            // Local work drained: pick up I/O completions before stealing
+            if (io_ctx_->poll() > 0) {
+                ctx = pop_local();
+            }
+
+            if (nullptr == ctx) {
+                ctx = steal_from_peer();
+
+                if (nullptr != ctx) {
+                    context::active()->attach(ctx);
+                }
+            }
+        }
+
+        return ctx;
+    }
+
+    /**
+     * Returns true if any fibers are ready to run on this worker.
+     */
+    bool has_ready_fibers() const noexcept override {
+        return !rqueue_.empty() || !pinned_queue_.empty();
+    }
+
+    /**
+     * Blocks the worker in its io_context until an I/O completion, a
+     * wakeup from a peer, or the given time point.
+     */
+    void suspend_until(std::chrono::steady_clock::time_point const& abs_time) noexcept override {
+        // A wakeup already consumed by pick_next()'s poll: return so the
+        // dispatcher can collect the fibers readied from remote threads
+        if (woken_) {
+            woken_ = false;
+            return;
+        }
+
+        pool_->idle.fetch_add(1, std::memory_order_seq_cst);
+        sleeping_.store(true, std::memory_order_seq_cst);
+
+        if (!peers_have_work()) {
+            if ((std::chrono::steady_clock::time_point::max)() == abs_time) {
+                io_ctx_->run_one();
+            } else {
+                io_ctx_->run_one_until(abs_time);
+            }
+        }
+
+        sleeping_.store(false, std::memory_order_relaxed);
+        pool_->idle.fetch_sub(1, std::memory_order_relaxed);
+        woken_ = false;
+
+        // Drain whatever else completed while we were blocked
+        io_ctx_->poll();
+    }
+
+    /**
+     * Wakes this worker from another thread. Wakeups are coalesced: only
+     * one no-op handler is in flight at a time.
+     */
+    void notify() noexcept override {
+        if (!notified_.exchange(true, std::memory_order_acq_rel)) {
+            boost::asio::post(*io_ctx_, [this]() {
+                woken_ = true;
+                notified_.store(false, std::memory_order_release);
+            });
+        }
+    }
+};
+
+}  // namespace asio
+}  // namespace fibers
+}  // namespace boost
+
+#endif  // NOG_FIBER_ASIO_WORK_STEALING_HPP
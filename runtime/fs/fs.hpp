@@ -4,6 +4,10 @@
  *
  * Provides filesystem operations for Bishop programs.
  * This header is included when programs import the fs module.
+ *
+ * Operations that read file or directory contents run on the blocking-
+ * offload pool, so a slow disk only parks the calling fiber. The stat-only
+ * checks stay inline; a thread hop would cost more than the syscall.
  */
 
 #pragma once
@@ -20,15 +24,17 @@ namespace fs {
  * Returns empty string if file cannot be read.
  */
 inline std::string read_file(const std::string& path) {
-    std::ifstream file(path);
+    return bishop::rt::offload([&path]() -> std::string {
+        std::ifstream file(path);
 
-    if (!file) {
-        return "";
-    }
+        if (!file) {
+            return "";
+        }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    });
 }
 
 /**
@@ -49,17 +55,19 @@ inline bool is_dir(const std::string& path) {
  * Lists all entries in a directory, separated by newlines.
  */
 inline std::string read_dir(const std::string& path) {
-    std::string result;
+    return bishop::rt::offload([&path]() {
+        std::string result;
 
-    for (const auto& entry : std::filesystem::directory_iterator(path)) {
-        if (!result.empty()) {
-            result += "\n";
-        }
+        for (const auto& entry : std::filesystem::directory_iterator(path)) {
+            if (!result.empty()) {
+                result += "\n";
+            }
 
-        result += entry.path().filename().string();
-    }
+            result += entry.path().filename().string();
+        }
 
-    return result;
+        return result;
+    });
 }
 
 }  // namespace fs
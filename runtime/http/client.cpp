@@ -0,0 +1,682 @@
+/**
+ * @file client.cpp
+ * @brief HTTP client for the Bishop HTTP runtime.
+ *
+ * Requests run on the calling fiber through boost::fibers::asio::yield,
+ * so a fiber waiting on an upstream parks instead of blocking the thread.
+ * Responses are parsed with llhttp. Connections are pooled per thread and
+ * host:port, and reused for as long as the server keeps them alive.
+ */
+
+#include <bishop/http.hpp>
+
+#include <array>
+#include <map>
+
+#include <strings.h>
+
+namespace http {
+
+namespace detail {
+
+using Clock = std::chrono::steady_clock;
+using tcp = boost::asio::ip::tcp;
+
+/**
+ * The parts of an http:// URL a request needs.
+ */
+struct ClientUrl {
+    std::string host;
+    std::string port = "80";
+    std::string authority;   // host[:port] as written, for the Host header
+    std::string target;      // path and query
+};
+
+/**
+ * Splits an http:// URL into out. Returns an error message, or "" if the
+ * URL is usable.
+ */
+static std::string parse_url(const std::string& url, ClientUrl& out) {
+    constexpr std::string_view scheme = "http://";
+
+    if (url.size() < scheme.size() || strncasecmp(url.c_str(), scheme.data(), scheme.size()) != 0) {
+        if (strncasecmp(url.c_str(), "https://", 8) == 0) {
+            return "https is not supported: " + url;
+        }
+
+        return "unsupported URL: " + url;
+    }
+
+    std::size_t start = scheme.size();
+    std::size_t end = url.find_first_of("/?#", start);
+    out.authority = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    out.target = end == std::string::npos ? "/" : url.substr(end);
+
+    if (out.target[0] != '/') {
+        out.target.insert(0, "/");
+    }
+
+    out.target.resize(std::min(out.target.find('#'), out.target.size()));
+
+    if (out.authority.empty() || out.authority.find('@') != std::string::npos) {
+        return "invalid URL host: " + url;
+    }
+
+    if (out.authority[0] == '[') {
+        // [v6 address] with an optional :port
+        std::size_t close = out.authority.find(']');
+
+        if (close == std::string::npos ||
+            (close + 1 < out.authority.size() && out.authority[close + 1] != ':')) {
+            return "invalid URL host: " + url;
+        }
+
+        out.host = out.authority.substr(1, close - 1);
+
+        if (close + 1 < out.authority.size()) {
+            out.port = out.authority.substr(close + 2);
+        }
+    } else {
+        std::size_t colon = out.authority.rfind(':');
+        out.host = out.authority.substr(0, colon);
+
+        if (colon != std::string::npos) {
+            out.port = out.authority.substr(colon + 1);
+        }
+    }
+
+    if (out.host.empty() || out.port.empty() ||
+        out.port.find_first_not_of("0123456789") != std::string::npos) {
+        return "invalid URL host: " + url;
+    }
+
+    return "";
+}
+
+/**
+ * A keep-alive connection to one host. The timer enforces the deadline
+ * of the request using the connection.
+ */
+struct ClientConnection {
+    tcp::socket socket;
+    boost::asio::steady_timer timer;
+    std::vector<char> buffer;
+    Clock::time_point idle_since;
+
+    explicit ClientConnection(boost::asio::io_context& io)
+        : socket(io), timer(io), buffer(16 * 1024) {}
+};
+
+/**
+ * Connections to one host:port. open counts both idle and checked-out
+ * connections, for max_connections_per_host.
+ */
+struct HostPool {
+    boost::fibers::mutex mutex;
+    boost::fibers::condition_variable released;
+    std::vector<std::unique_ptr<ClientConnection>> idle;   // most recently used last
+    std::vector<tcp::endpoint> endpoints;                  // resolved on first connect
+    boost::asio::io_context* io = nullptr;                 // runs every connection in the pool
+    int open = 0;
+};
+
+/**
+ * A socket belongs to the io_context of the thread that opened it, so
+ * each thread has its own pool per host and a connection is only ever
+ * handed to requests started on the thread that owns it. Those requests
+ * pin their fiber there until they finish.
+ */
+struct ClientPool {
+    std::mutex mutex;   // guards the map; each host has its own lock
+    std::map<std::pair<const boost::asio::io_context*, std::string>, std::unique_ptr<HostPool>> hosts;
+};
+
+std::shared_ptr<ClientPool> new_client_pool() {
+    return std::make_shared<ClientPool>();
+}
+
+/**
+ * Returns the calling thread's pool for key ("host:port"), creating it on
+ * first use.
+ */
+static HostPool& host_pool(ClientPool& pool, const std::string& key) {
+    boost::asio::io_context* io = &bishop::rt::io_context();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto& host = pool.hosts[{io, key}];
+
+    if (!host) {
+        host = std::make_unique<HostPool>();
+        host->io = io;
+    }
+
+    return *host;
+}
+
+/**
+ * Takes the most recently used idle connection into conn, closing those
+ * idle for longer than idle_timeout_ms, or reserves a slot for a new
+ * connection and leaves conn empty. At max_connections_per_host it waits
+ * for a release. Returns false if the deadline passes first.
+ */
+static bool acquire(HostPool& host, const Client& client, Clock::time_point deadline,
+                    std::unique_ptr<ClientConnection>& conn) {
+    std::unique_lock<boost::fibers::mutex> lock(host.mutex);
+
+    while (true) {
+        if (client.idle_timeout_ms > 0) {
+            auto cutoff = Clock::now() - std::chrono::milliseconds(client.idle_timeout_ms);
+            auto fresh = std::find_if(host.idle.begin(), host.idle.end(),
+                                      [cutoff](const auto& idle) { return idle->idle_since >= cutoff; });
+            host.open -= static_cast<int>(fresh - host.idle.begin());
+            host.idle.erase(host.idle.begin(), fresh);
+        }
+
+        if (!host.idle.empty()) {
+            conn = std::move(host.idle.back());
+            host.idle.pop_back();
+            return true;
+        }
+
+        if (client.max_connections_per_host <= 0 || host.open < client.max_connections_per_host) {
+            host.open++;
+            return true;
+        }
+
+        if (deadline == Clock::time_point::max()) {
+            host.released.wait(lock);
+        } else if (host.released.wait_until(lock, deadline) == boost::fibers::cv_status::timeout) {
+            return false;
+        }
+    }
+}
+
+/**
+ * Returns conn to the idle list, or gives up its slot if conn is empty or
+ * the idle list is full, and wakes one request waiting for a connection.
+ */
+static void release(HostPool& host, const Client& client, std::unique_ptr<ClientConnection> conn) {
+    {
+        std::lock_guard<boost::fibers::mutex> lock(host.mutex);
+
+        if (conn && static_cast<int>(host.idle.size()) < client.max_idle_per_host) {
+            conn->idle_since = Clock::now();
+            host.idle.push_back(std::move(conn));
+        } else {
+            host.open--;
+        }
+    }
+
+    host.released.notify_one();
+}
+
+/**
+ * Cancels the connection's pending I/O once the request's deadline has
+ * passed, for as long as the guard lives. The handler runs on the
+ * connection's io_context and touches the socket unlocked, so the fiber
+ * using the connection must be pinned to that thread.
+ */
+class RequestDeadline {
+public:
+    RequestDeadline(ClientConnection& conn, Clock::time_point deadline) : conn_(conn) {
+        if (deadline == Clock::time_point::max()) {
+            return;
+        }
+
+        conn_.timer.expires_at(deadline);
+
+        // The expiry may already be queued when the guard goes away, and
+        // the connection may be back in the pool by then, so the handler
+        // only touches the socket while the guard's token is alive
+        conn_.timer.async_wait([&socket = conn_.socket, token = std::weak_ptr<bool>(expired_)](
+                                   const boost::system::error_code& ec) {
+            auto expired = token.lock();
+
+            if (ec || !expired) {
+                return;
+            }
+
+            *expired = true;
+            boost::system::error_code ignored;
+            socket.cancel(ignored);
+        });
+    }
+
+    ~RequestDeadline() {
+        conn_.timer.cancel();
+    }
+
+    bool expired() const {
+        return *expired_;
+    }
+
+private:
+    ClientConnection& conn_;
+    std::shared_ptr<bool> expired_ = std::make_shared<bool>(false);
+};
+
+/**
+ * Connects conn to the host, resolving its name on first use. A failed
+ * connect forgets the addresses, so the next request resolves again.
+ * Returns an error message, or "" once connected.
+ */
+static std::string connect(HostPool& host, ClientConnection& conn, const ClientUrl& url) {
+    std::vector<tcp::endpoint> endpoints;
+
+    {
+        std::lock_guard<boost::fibers::mutex> lock(host.mutex);
+        endpoints = host.endpoints;
+    }
+
+    boost::system::error_code ec;
+
+    if (endpoints.empty()) {
+        tcp::resolver resolver(conn.socket.get_executor());
+        auto results = resolver.async_resolve(url.host, url.port, boost::fibers::asio::yield[ec]);
+
+        if (ec) {
+            return "cannot resolve " + url.host + ": " + ec.message();
+        }
+
+        for (const auto& entry : results) {
+            endpoints.push_back(entry.endpoint());
+        }
+
+        std::lock_guard<boost::fibers::mutex> lock(host.mutex);
+        host.endpoints = endpoints;
+    }
+
+    boost::asio::async_connect(conn.socket, endpoints, boost::fibers::asio::yield[ec]);
+
+    if (ec) {
+        std::lock_guard<boost::fibers::mutex> lock(host.mutex);
+        host.endpoints.clear();
+        return "cannot connect to " + url.authority + ": " + ec.message();
+    }
+
+    conn.socket.set_option(tcp::no_delay(true), ec);
+    return "";
+}
+
+/**
+ * Serializes the request line and headers.
+ */
+static std::string request_head(const std::string& method, const ClientUrl& url, const std::string& headers,
+                                const std::string& content_type, const std::string& body) {
+    std::string head;
+    head.reserve(96 + url.target.size() + url.authority.size() + headers.size() + content_type.size());
+    head += method;
+    head += ' ';
+    head += url.target;
+    head += " HTTP/1.1\r\nHost: ";
+    head += url.authority;
+    head += "\r\n";
+    head += headers;
+
+    if (!content_type.empty()) {
+        head += "Content-Type: ";
+        head += content_type;
+        head += "\r\n";
+    }
+
+    if (!body.empty() || method == "POST" || method == "PUT" || method == "PATCH") {
+        head += "Content-Length: ";
+        head += std::to_string(body.size());
+        head += "\r\n";
+    }
+
+    head += "\r\n";
+    return head;
+}
+
+/**
+ * llhttp state for one response.
+ */
+struct ResponseParse {
+    llhttp_t parser;
+    Response* response = nullptr;
+    std::string field;            // name of the current header
+    bool in_value = false;        // last header callback was for a value
+    bool content_type = false;    // the current header is Content-Type
+    bool head_request = false;    // a response to HEAD has no body
+    std::size_t max_body = 0;     // longer bodies fail the request; 0 = no limit
+    bool too_large = false;
+    bool complete = false;
+};
+
+static int on_response_header_field(llhttp_t* parser, const char* at, size_t len) {
+    auto* parse = static_cast<ResponseParse*>(parser->data);
+
+    if (parse->in_value) {
+        parse->response->received += "\r\n";
+        parse->field.clear();
+        parse->in_value = false;
+    }
+
+    parse->field.append(at, len);
+    return 0;
+}
+
+static int on_response_header_value(llhttp_t* parser, const char* at, size_t len) {
+    auto* parse = static_cast<ResponseParse*>(parser->data);
+
+    if (!parse->in_value) {
+        parse->in_value = true;
+        parse->content_type = strcasecmp(parse->field.c_str(), "content-type") == 0;
+        parse->response->received += parse->field;
+        parse->response->received += ": ";
+    }
+
+    if (parse->content_type) {
+        parse->response->content_type.append(at, len);
+    }
+
+    parse->response->received.append(at, len);
+    return 0;
+}
+
+static int on_response_headers_complete(llhttp_t* parser) {
+    auto* parse = static_cast<ResponseParse*>(parser->data);
+    parse->response->status = parser->status_code;
+
+    if (parse->in_value) {
+        parse->response->received += "\r\n";
+    }
+
+    // Trailers, if any, start a new field
+    parse->field.clear();
+    parse->in_value = false;
+
+    // 1 tells llhttp that this response has no body
+    return parse->head_request ? 1 : 0;
+}
+
+static int on_response_body(llhttp_t* parser, const char* at, size_t len) {
+    auto* parse = static_cast<ResponseParse*>(parser->data);
+
+    if (parse->max_body > 0 && parse->response->body.size() + len > parse->max_body) {
+        parse->too_large = true;
+        return -1;
+    }
+
+    parse->response->body.append(at, len);
+    return 0;
+}
+
+/**
+ * Pauses the parser at the end of the response, so bytes past it show
+ * up as unparsed. Interim 1xx responses are skipped.
+ */
+static int on_response_complete(llhttp_t* parser) {
+    auto* parse = static_cast<ResponseParse*>(parser->data);
+
+    if (parser->status_code >= 100 && parser->status_code < 200 && parser->status_code != 101) {
+        parse->response->content_type.clear();
+        parse->response->received.clear();
+        parse->field.clear();
+        parse->in_value = false;
+        return 0;
+    }
+
+    parse->complete = true;
+    return HPE_PAUSED;
+}
+
+static const llhttp_settings_t& response_settings() {
+    static const llhttp_settings_t settings = []() {
+        llhttp_settings_t s;
+        llhttp_settings_init(&s);
+        s.on_header_field = on_response_header_field;
+        s.on_header_value = on_response_header_value;
+        s.on_headers_complete = on_response_headers_complete;
+        s.on_body = on_response_body;
+        s.on_message_complete = on_response_complete;
+        return s;
+    }();
+
+    return settings;
+}
+
+/**
+ * Outcome of one request on one connection.
+ */
+struct Exchange {
+    std::string error;         // empty on success
+    bool keep_alive = false;   // the connection can carry another request
+    bool received = false;     // response bytes arrived
+};
+
+/**
+ * Inflates a gzip or deflate response body in place, to at most max_body
+ * bytes (0 = no limit); other codings are left as they are. Returns an
+ * error message, or "" if the body is usable.
+ */
+static std::string decode_body(Response& response, std::size_t max_body) {
+    std::string coding = response.header("Content-Encoding");
+    Encoding encoding = Encoding::Identity;
+
+    if (strcasecmp(coding.c_str(), "gzip") == 0 || strcasecmp(coding.c_str(), "x-gzip") == 0) {
+        encoding = Encoding::Gzip;
+    } else if (strcasecmp(coding.c_str(), "deflate") == 0) {
+        encoding = Encoding::Deflate;
+    }
+
+    if (encoding == Encoding::Identity || response.body.empty()) {
+        return "";
+    }
+
+    std::string body;
+    std::string error = decompress(response.body, encoding, max_body, body);
+
+    if (!error.empty()) {
+        return error;
+    }
+
+    response.body = std::move(body);
+    return "";
+}
+
+/**
+ * Writes the request and reads its response into response, with its body
+ * decoded.
+ */
+static Exchange exchange(ClientConnection& conn, const std::string& head, const std::string& body,
+                         bool head_request, std::size_t max_body, Response& response) {
+    Exchange result;
+    ResponseParse parse;
+    parse.response = &response;
+    parse.head_request = head_request;
+    parse.max_body = max_body;
+    llhttp_init(&parse.parser, HTTP_RESPONSE, &response_settings());
+    parse.parser.data = &parse;
+
+    boost::system::error_code ec;
+    std::array<boost::asio::const_buffer, 2> buffers{boost::asio::buffer(head), boost::asio::buffer(body)};
+    boost::asio::async_write(conn.socket, buffers, boost::fibers::asio::yield[ec]);
+
+    if (ec) {
+        result.error = ec.message();
+        return result;
+    }
+
+    while (!parse.complete) {
+        std::size_t n = conn.socket.async_read_some(boost::asio::buffer(conn.buffer),
+                                                    boost::fibers::asio::yield[ec]);
+
+        if (ec == boost::asio::error::eof) {
+            // A response without Content-Length ends when the server closes
+            if (result.received) {
+                llhttp_finish(&parse.parser);
+            }
+
+            if (!parse.complete) {
+                result.error = result.received ? "connection closed mid-response"
+                                               : "connection closed before the response";
+            }
+
+            return result;
+        }
+
+        if (ec) {
+            result.error = ec.message();
+            return result;
+        }
+
+        result.received = true;
+        llhttp_errno err = llhttp_execute(&parse.parser, conn.buffer.data(), n);
+
+        if (err == HPE_PAUSED) {
+            // Bytes past the response mean the server is out of step with
+            // us, so the connection is not reused
+            bool trailing = llhttp_get_error_pos(&parse.parser) != conn.buffer.data() + n;
+            result.keep_alive = !trailing && llhttp_should_keep_alive(&parse.parser);
+        } else if (parse.too_large) {
+            result.error = "response body larger than " + std::to_string(max_body) + " bytes";
+            return result;
+        } else if (err != HPE_OK) {
+            result.error = std::string("invalid response: ") + llhttp_errno_name(err);
+            return result;
+        }
+    }
+
+    result.error = decode_body(response, max_body);
+    return result;
+}
+
+/**
+ * Methods a request can be retried with after a failure on a reused
+ * connection.
+ */
+static bool idempotent(const std::string& method) {
+    return method == "GET" || method == "HEAD" || method == "PUT" || method == "DELETE" ||
+           method == "OPTIONS" || method == "TRACE";
+}
+
+}  // namespace detail
+
+bishop::rt::Result<Response> Client::request(const std::string& method, const std::string& url,
+                                             const std::string& content_type, const std::string& body) {
+    detail::ClientUrl target;
+    std::string error = detail::parse_url(url, target);
+
+    if (!error.empty()) {
+        return bishop::rt::make_error<Response>(error);
+    }
+
+    auto deadline = timeout_ms > 0 ? detail::Clock::now() + std::chrono::milliseconds(timeout_ms)
+                                   : detail::Clock::time_point::max();
+
+    // The pool, connections and deadline timers used below belong to this
+    // thread's io_context, so the fiber must not be stolen until it is done
+    bishop::rt::PinnedFiber pin;
+    detail::HostPool& host = detail::host_pool(*pool, target.host + ":" + target.port);
+    std::string head = detail::request_head(method, target, headers, content_type, body);
+
+    for (int attempt = 0;; attempt++) {
+        std::unique_ptr<detail::ClientConnection> conn;
+
+        if (!detail::acquire(host, *this, deadline, conn)) {
+            return bishop::rt::make_error<Response>("request timed out: " + method + " " + url);
+        }
+
+        bool reused = conn != nullptr;
+
+        if (!reused) {
+            conn = std::make_unique<detail::ClientConnection>(*host.io);
+        }
+
+        Response response{};
+        detail::Exchange result;
+        bool expired = false;
+
+        {
+            detail::RequestDeadline guard(*conn, deadline);
+
+            if (!reused) {
+                result.error = detail::connect(host, *conn, target);
+            }
+
+            if (result.error.empty()) {
+                std::size_t max_body = static_cast<std::size_t>(std::max(0, max_body_bytes));
+                result = detail::exchange(*conn, head, body, method == "HEAD", max_body, response);
+            }
+
+            expired = guard.expired();
+        }
+
+        if (result.error.empty()) {
+            detail::release(host, *this, result.keep_alive ? std::move(conn) : nullptr);
+            return response;
+        }
+
+        detail::release(host, *this, nullptr);
+
+        if (expired) {
+            return bishop::rt::make_error<Response>("request timed out: " + method + " " + url);
+        }
+
+        // A pooled connection the server closed while it sat idle fails
+        // before any response arrives; that is worth one fresh attempt
+        if (reused && !result.received && attempt == 0 && detail::idempotent(method)) {
+            continue;
+        }
+
+        return bishop::rt::make_error<Response>(method + " " + url + ": " + result.error);
+    }
+}
+
+void Client::set_header(const std::string& name, const std::string& value) {
+    std::size_t start = 0;
+
+    while (start < headers.size()) {
+        std::size_t end = headers.find("\r\n", start) + 2;
+
+        if (headers.size() - start > name.size() && headers[start + name.size()] == ':' &&
+            strncasecmp(headers.c_str() + start, name.c_str(), name.size()) == 0) {
+            headers.erase(start, end - start);
+        } else {
+            start = end;
+        }
+    }
+
+    // A line break would end the header early and start another
+    auto append_line_safe = [this](const std::string& text) {
+        for (char c : text) {
+            if (c != '\r' && c != '\n') {
+                headers += c;
+            }
+        }
+    };
+
+    append_line_safe(name);
+    headers += ": ";
+    append_line_safe(value);
+    headers += "\r\n";
+}
+
+bishop::rt::Result<Response> Client::get(const std::string& url) {
+    return request("GET", url, "", "");
+}
+
+bishop::rt::Result<Response> Client::post(const std::string& url, const std::string& content_type,
+                                          const std::string& body) {
+    return request("POST", url, content_type, body);
+}
+
+/**
+ * The Client behind http::get() and http::post().
+ */
+static Client& default_client() {
+    static Client client;
+    return client;
+}
+
+bishop::rt::Result<Response> get(const std::string& url) {
+    return default_client().get(url);
+}
+
+bishop::rt::Result<Response> post(const std::string& url, const std::string& content_type,
+                                  const std::string& body) {
+    return default_client().post(url, content_type, body);
+}
+
+}  // namespace http
@@ -8,32 +8,134 @@
 
 #include <bishop/http.hpp>
 
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
 namespace http {
 
 namespace detail {
 
+// Method and URL may arrive split across reads, so callbacks append
 int on_method(llhttp_t* parser, const char* at, size_t len) {
     auto* ctx = static_cast<HttpParserContext*>(parser->data);
-    ctx->method.assign(at, len);
+    ctx->method.append(at, len);
     return 0;
 }
 
 int on_url(llhttp_t* parser, const char* at, size_t len) {
     auto* ctx = static_cast<HttpParserContext*>(parser->data);
-    ctx->url.assign(at, len);
+
+    if (ctx->url.size() + len > bishop::rt::http_max_header_bytes()) {
+        return -1;
+    }
+
+    ctx->url.append(at, len);
+    return 0;
+}
+
+/**
+ * Extends view with the next piece of the same token, which the
+ * connection keeps contiguous with it.
+ */
+static bool extend(std::string_view& view, const char* at, size_t len) {
+    if (view.empty()) {
+        view = std::string_view(at, len);
+        return true;
+    }
+
+    if (view.data() + view.size() != at) {
+        return false;
+    }
+
+    view = std::string_view(view.data(), view.size() + len);
+    return true;
+}
+
+int on_header_field(llhttp_t* parser, const char* at, size_t len) {
+    auto* ctx = static_cast<HttpParserContext*>(parser->data);
+
+    if (ctx->headers.empty() || ctx->in_value) {
+        ctx->headers.push_back(Header{});
+        ctx->in_value = false;
+    }
+
+    return extend(ctx->headers.back().name, at, len) ? 0 : -1;
+}
+
+int on_header_value(llhttp_t* parser, const char* at, size_t len) {
+    auto* ctx = static_cast<HttpParserContext*>(parser->data);
+    ctx->in_value = true;
+    return extend(ctx->headers.back().value, at, len) ? 0 : -1;
+}
+
+int on_headers_complete(llhttp_t* parser) {
+    auto* ctx = static_cast<HttpParserContext*>(parser->data);
+    ctx->headers_complete = true;
     return 0;
 }
 
 int on_body(llhttp_t* parser, const char* at, size_t len) {
     auto* ctx = static_cast<HttpParserContext*>(parser->data);
     ctx->body.append(at, len);
+    ctx->body_size += len;
     return 0;
 }
 
 int on_message_complete(llhttp_t* parser) {
     auto* ctx = static_cast<HttpParserContext*>(parser->data);
     ctx->message_complete = true;
-    return 0;
+    ctx->keep_alive = llhttp_should_keep_alive(parser) != 0;
+    return HPE_PAUSED;
+}
+
+/**
+ * Parser settings shared by every connection.
+ */
+static const llhttp_settings_t& parser_settings() {
+    static const llhttp_settings_t settings = []() {
+        llhttp_settings_t s;
+        llhttp_settings_init(&s);
+        s.on_method = on_method;
+        s.on_url = on_url;
+        s.on_header_field = on_header_field;
+        s.on_header_value = on_header_value;
+        s.on_headers_complete = on_headers_complete;
+        s.on_body = on_body;
+        s.on_message_complete = on_message_complete;
+        return s;
+    }();
+
+    return settings;
+}
+
+std::string open_acceptor(boost::asio::ip::tcp::acceptor& acceptor, int port, bool reuse_port) {
+    using reuse_port_option = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+    try {
+        acceptor.open(boost::asio::ip::tcp::v4());
+        acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+
+        if (reuse_port) {
+            acceptor.set_option(reuse_port_option(true));
+        }
+
+        acceptor.bind({boost::asio::ip::tcp::v4(), static_cast<boost::asio::ip::port_type>(port)});
+        acceptor.listen();
+    } catch (const boost::system::system_error& e) {
+        return "Failed to bind to port " + std::to_string(port) + ": " + e.what();
+    }
+
+    return "";
 }
 
 }  // namespace detail
@@ -50,127 +152,1933 @@ Response not_found() {
     return Response{404, "text/plain", "Not Found"};
 }
 
-std::string format_response(const Response& resp) {
-    std::string status_text;
+namespace detail {
+
+/**
+ * Returns the precomputed status line for common codes, or an empty view.
+ */
+static std::string_view status_line(int status) {
+    switch (status) {
+        case 200: return "HTTP/1.1 200 OK\r\n";
+        case 201: return "HTTP/1.1 201 Created\r\n";
+        case 204: return "HTTP/1.1 204 No Content\r\n";
+        case 206: return "HTTP/1.1 206 Partial Content\r\n";
+        case 301: return "HTTP/1.1 301 Moved Permanently\r\n";
+        case 302: return "HTTP/1.1 302 Found\r\n";
+        case 304: return "HTTP/1.1 304 Not Modified\r\n";
+        case 400: return "HTTP/1.1 400 Bad Request\r\n";
+        case 403: return "HTTP/1.1 403 Forbidden\r\n";
+        case 404: return "HTTP/1.1 404 Not Found\r\n";
+        case 405: return "HTTP/1.1 405 Method Not Allowed\r\n";
+        case 413: return "HTTP/1.1 413 Payload Too Large\r\n";
+        case 416: return "HTTP/1.1 416 Range Not Satisfiable\r\n";
+        case 431: return "HTTP/1.1 431 Request Header Fields Too Large\r\n";
+        case 500: return "HTTP/1.1 500 Internal Server Error\r\n";
+        case 503: return "HTTP/1.1 503 Service Unavailable\r\n";
+        default: return {};
+    }
+}
+
+constexpr std::string_view CONTENT_TYPE = "Content-Type: ";
+constexpr std::string_view CONTENT_LENGTH = "\r\nContent-Length: ";
+constexpr std::string_view KEEP_ALIVE = "Connection: keep-alive\r\n\r\n";
+constexpr std::string_view CLOSE = "Connection: close\r\n\r\n";
+
+/**
+ * Appends the status line and headers for resp, except Connection.
+ */
+static void append_fields(std::string& head, const Response& resp) {
+    char digits[24];
+    std::string_view line = status_line(resp.status);
+
+    if (!line.empty()) {
+        head += line;
+    } else {
+        char* end = std::to_chars(digits, digits + sizeof(digits), resp.status).ptr;
+        head += "HTTP/1.1 ";
+        head.append(digits, end);
+        head += " Unknown\r\n";
+    }
+
+    head += CONTENT_TYPE;
+    head += resp.content_type;
 
-    switch (resp.status) {
-        case 200: status_text = "OK"; break;
-        case 404: status_text = "Not Found"; break;
-        case 500: status_text = "Internal Server Error"; break;
-        default: status_text = "Unknown"; break;
+    // A 304 has no body, and a Content-Length would describe the 200's;
+    // a streamed body's length is not known up front
+    if (resp.status != 304 && !resp.streamed) {
+        std::size_t length = resp.file ? resp.file_length : resp.encoded ? resp.encoded->size() : resp.body.size();
+        head += CONTENT_LENGTH;
+        head.append(digits, std::to_chars(digits, digits + sizeof(digits), length).ptr);
     }
 
-    std::string response = "HTTP/1.1 " + std::to_string(resp.status) + " " + status_text + "\r\n";
-    response += "Content-Type: " + resp.content_type + "\r\n";
-    response += "Content-Length: " + std::to_string(resp.body.size()) + "\r\n";
-    response += "Connection: close\r\n";
-    response += "\r\n";
-    response += resp.body;
-    return response;
+    head += "\r\n";
+    head += resp.headers;
 }
 
-Request read_request(boost::asio::ip::tcp::socket& socket) {
-    llhttp_t parser;
-    llhttp_settings_t settings;
-    llhttp_settings_init(&settings);
-    settings.on_method = detail::on_method;
-    settings.on_url = detail::on_url;
-    settings.on_body = detail::on_body;
-    settings.on_message_complete = detail::on_message_complete;
+void append_head(std::string& head, const Response& resp, bool keep_alive) {
+    append_fields(head, resp);
+    head += keep_alive ? KEEP_ALIVE : CLOSE;
+}
 
-    HttpParserContext ctx;
-    llhttp_init(&parser, HTTP_REQUEST, &settings);
-    parser.data = &ctx;
+}  // namespace detail
 
-    char buffer[8192];
-    boost::system::error_code ec;
+/**
+ * ASCII case-insensitive comparison, as header names require.
+ */
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
 
-    // First read - yields fiber until data available
-    size_t n = socket.async_read_some(
-        boost::asio::buffer(buffer),
-        boost::fibers::asio::yield[ec]);
+    for (std::size_t i = 0; i < a.size(); i++) {
+        char x = a[i] >= 'A' && a[i] <= 'Z' ? a[i] + 32 : a[i];
+        char y = b[i] >= 'A' && b[i] <= 'Z' ? b[i] + 32 : b[i];
 
-    if (ec) {
-        return Request{"GET", "/", ""};
+        if (x != y) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Strips the spaces and tabs HTTP allows around list elements.
+ */
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
     }
 
-    llhttp_errno err = llhttp_execute(&parser, buffer, n);
+    return text;
+}
+
+namespace detail {
 
-    if (err != HPE_OK && !ctx.message_complete) {
-        return Request{"GET", "/", ""};
+std::string_view find_header(const HeaderTable& headers, std::string_view name) {
+    for (const Header& h : headers) {
+        if (iequals(h.name, name)) {
+            return h.value;
+        }
     }
 
-    // Continue reading only if message incomplete (large POST, slow client)
-    while (!ctx.message_complete) {
-        n = socket.async_read_some(
-            boost::asio::buffer(buffer),
-            boost::fibers::asio::yield[ec]);
+    return {};
+}
+
+}  // namespace detail
+
+std::string_view Request::header_view(std::string_view name) const {
+    return detail::find_header(headers, name);
+}
+
+std::string Request::header(const std::string& name) const {
+    return std::string(header_view(name));
+}
 
-        if (ec) {
-            return Request{"GET", "/", ""};
+std::string Request::param(const std::string& name) const {
+    for (const Param& p : params) {
+        if (p.name == name) {
+            return path.substr(p.offset, p.size);
         }
+    }
 
-        err = llhttp_execute(&parser, buffer, n);
+    return "";
+}
+
+/**
+ * Returns the value of the named header in lines of "Name: value\r\n",
+ * or "" if there is none.
+ */
+static std::string_view find_header_line(std::string_view lines, std::string_view name) {
+    while (!lines.empty()) {
+        std::size_t end = std::min(lines.find("\r\n"), lines.size());
+        std::string_view line = lines.substr(0, end);
+        lines.remove_prefix(std::min(end + 2, lines.size()));
+        std::size_t colon = line.find(':');
 
-        if (err != HPE_OK && !ctx.message_complete) {
-            return Request{"GET", "/", ""};
+        if (colon != std::string_view::npos && iequals(line.substr(0, colon), name)) {
+            return trim(line.substr(colon + 1));
         }
     }
 
-    return Request{ctx.method, ctx.url, ctx.body};
+    return "";
 }
 
-void App::get(const std::string& path, std::function<Response(Request)> handler) {
-    routes.push_back({"GET", path, handler});
+/**
+ * True if a handler's response sets a cookie, so it belongs to one client.
+ */
+static bool sets_cookie(const Response& resp) {
+    return !find_header_line(resp.headers, "Set-Cookie").empty();
 }
 
-void App::post(const std::string& path, std::function<Response(Request)> handler) {
-    routes.push_back({"POST", path, handler});
+std::string Response::header(const std::string& name) const {
+    return std::string(find_header_line(received, name));
 }
 
-Response App::route(const Request& req) {
-    for (const auto& [method, path, handler] : routes) {
-        if (req.method == method && req.path == path) {
-            return handler(req);
+std::string Request::read_body() {
+    if (body_stream) {
+        return body_stream->read_body();
+    }
+
+    if (body_read) {
+        return "";
+    }
+
+    body_read = true;
+    return body;
+}
+
+Writer Request::stream(int status, const std::string& content_type) {
+    if (connection) {
+        connection->begin_stream(status, content_type);
+    }
+
+    return Writer{connection, status, content_type};
+}
+
+bool Writer::write(const std::string& data) {
+    return connection && connection->write_chunk(data);
+}
+
+bool Writer::flush() {
+    return connection && connection->flush_stream();
+}
+
+Response Writer::end() {
+    if (connection) {
+        connection->finish_stream();
+    }
+
+    Response resp{status, content_type, ""};
+    resp.streamed = true;
+    return resp;
+}
+
+MappedFile::~MappedFile() {
+    if (data) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+namespace detail {
+
+/**
+ * Extensions and their Content-Types. Text types declare UTF-8.
+ */
+static constexpr std::pair<std::string_view, std::string_view> MIME_TYPES[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "text/javascript; charset=utf-8"},
+    {"mjs", "text/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"md", "text/markdown; charset=utf-8"},
+    {"csv", "text/csv; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+    {"zip", "application/zip"},
+    {"gz", "application/gzip"},
+    {"mp3", "audio/mpeg"},
+    {"wav", "audio/wav"},
+    {"ogg", "audio/ogg"},
+    {"mp4", "video/mp4"},
+    {"webm", "video/webm"},
+};
+
+std::string_view mime_type(std::string_view path) {
+    std::size_t dot = path.rfind('.');
+
+    if (dot != std::string_view::npos && path.find('/', dot) == std::string_view::npos) {
+        std::string_view ext = path.substr(dot + 1);
+
+        for (const auto& [known, type] : MIME_TYPES) {
+            if (iequals(ext, known)) {
+                return type;
+            }
         }
     }
 
-    return not_found();
+    return "application/octet-stream";
 }
 
-void App::listen(int port) {
-    boost::asio::ip::tcp::acceptor acceptor(bishop::rt::io_context());
+/**
+ * Mappings of recently served files, split into shards by path so
+ * requests for different files rarely share a lock. A shard's lock only
+ * guards its index and LRU list: stat, open and mmap run before it is
+ * taken, and mappings it evicts are unmapped after it is released.
+ */
+class FileCache {
+public:
+    /**
+     * Returns the mapping for path if it still matches the file's inode,
+     * size and mtime in st, or nullptr.
+     */
+    std::shared_ptr<const MappedFile> find(const std::string& path, const struct stat& st);
 
-    try {
-        acceptor.open(boost::asio::ip::tcp::v4());
-        acceptor.set_option(boost::asio::socket_base::reuse_address(true));
-        acceptor.bind({boost::asio::ip::tcp::v4(), static_cast<boost::asio::ip::port_type>(port)});
-        acceptor.listen();
-    } catch (const boost::system::system_error& e) {
-        std::cerr << "Error: Failed to bind to port " << port << ": " << e.what() << std::endl;
+    /**
+     * Adds or replaces the mapping for path, evicting the shard's least
+     * recently used mappings past its share of ENTRIES.
+     */
+    void insert(const std::string& path, std::shared_ptr<const MappedFile> mapped);
+
+private:
+    static constexpr std::size_t ENTRIES = 1024;
+    static constexpr std::size_t SHARDS = 16;
+
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const MappedFile> mapped;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;   // most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;   // views of Entry::path
+    };
+
+    Shard& shard(std::string_view path) {
+        return shards_[std::hash<std::string_view>{}(path) % SHARDS];
+    }
+
+    std::array<Shard, SHARDS> shards_;
+};
+
+/**
+ * Modification time of st in nanoseconds.
+ */
+static std::int64_t mtime_ns(const struct stat& st) {
+    return static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+std::shared_ptr<const MappedFile> FileCache::find(const std::string& path, const struct stat& st) {
+    Shard& s = shard(path);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(path);
+
+    if (it == s.index.end()) {
+        return nullptr;
+    }
+
+    const MappedFile& mapped = *it->second->mapped;
+
+    if (mapped.inode != st.st_ino || mapped.size != static_cast<std::size_t>(st.st_size) ||
+        mapped.mtime_ns != mtime_ns(st)) {
+        return nullptr;
+    }
+
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    return it->second->mapped;
+}
+
+void FileCache::insert(const std::string& path, std::shared_ptr<const MappedFile> mapped) {
+    // Declared before the lock, so the last references to evicted
+    // mappings are dropped, and the files unmapped, after it is released
+    std::vector<std::shared_ptr<const MappedFile>> evicted;
+    Shard& s = shard(path);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(path);
+
+    if (it != s.index.end()) {
+        evicted.push_back(std::exchange(it->second->mapped, std::move(mapped)));
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        return;
+    }
+
+    s.lru.push_front(Entry{path, std::move(mapped)});
+    s.index.emplace(s.lru.front().path, s.lru.begin());
+
+    while (s.lru.size() > ENTRIES / SHARDS) {
+        evicted.push_back(std::move(s.lru.back().mapped));
+        s.index.erase(s.lru.back().path);
+        s.lru.pop_back();
+    }
+}
+
+static FileCache file_cache;
+
+/**
+ * Appends value to out in the given base, lowercase.
+ */
+static void append_number(std::string& out, std::uint64_t value, int base = 10) {
+    char digits[24];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), value, base).ptr);
+}
+
+/**
+ * Maps the regular file at path, or returns the cached mapping if the
+ * file's inode, size and mtime have not changed. Returns nullptr if the
+ * file cannot be opened or is not a regular file. Two requests missing
+ * on the same file at once both map it, and the later mapping is kept.
+ */
+static std::shared_ptr<const MappedFile> map_file(const std::string& path) {
+    struct stat st;
+
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return nullptr;
+    }
+
+    if (std::shared_ptr<const MappedFile> cached = file_cache.find(path, st)) {
+        return cached;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    auto mapped = std::make_shared<MappedFile>();
+    mapped->size = static_cast<std::size_t>(st.st_size);
+    mapped->inode = st.st_ino;
+    mapped->mtime_ns = mtime_ns(st);
+
+    if (mapped->size > 0) {
+        void* data = mmap(nullptr, mapped->size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (data == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+
+        mapped->data = static_cast<const char*>(data);
+    }
+
+    close(fd);
+
+    mapped->etag = "\"";
+    append_number(mapped->etag, st.st_ino, 16);
+    mapped->etag += '-';
+    append_number(mapped->etag, mapped->size, 16);
+    mapped->etag += '-';
+    append_number(mapped->etag, static_cast<std::uint64_t>(mapped->mtime_ns), 16);
+    mapped->etag += '"';
+
+    char date[64];
+    struct tm tm;
+    gmtime_r(&st.st_mtim.tv_sec, &tm);
+    mapped->last_modified.assign(date, std::strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm));
+
+    file_cache.insert(path, mapped);
+    return mapped;
+}
+
+/**
+ * True if an If-None-Match list names etag, comparing weakly, or is "*".
+ */
+static bool etag_matches(std::string_view list, std::string_view etag) {
+    while (!list.empty()) {
+        std::size_t comma = std::min(list.find(','), list.size());
+        std::string_view tag = trim(list.substr(0, comma));
+        list.remove_prefix(std::min(comma + 1, list.size()));
+
+        if (tag.starts_with("W/")) {
+            tag.remove_prefix(2);
+        }
+
+        if (tag == "*" || tag == etag) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Parses an unsigned decimal that makes up all of text.
+ */
+static bool parse_size(std::string_view text, std::size_t& value) {
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && ec == std::errc() && end == text.data() + text.size();
+}
+
+enum class RangeResult { Ignore, Satisfiable, Unsatisfiable };
+
+/**
+ * Parses a single "bytes=first-last", "bytes=first-" or "bytes=-suffix"
+ * range against a file of size bytes. Multiple ranges and malformed
+ * headers are ignored, so the whole file is sent.
+ */
+static RangeResult parse_range(std::string_view spec, std::size_t size, std::size_t& first, std::size_t& last) {
+    if (!spec.starts_with("bytes=") || spec.find(',') != std::string_view::npos) {
+        return RangeResult::Ignore;
+    }
+
+    spec.remove_prefix(6);
+    std::size_t dash = spec.find('-');
+
+    if (dash == std::string_view::npos) {
+        return RangeResult::Ignore;
+    }
+
+    std::string_view from = spec.substr(0, dash);
+    std::string_view to = spec.substr(dash + 1);
+
+    if (from.empty()) {
+        std::size_t suffix = 0;
+
+        if (!parse_size(to, suffix)) {
+            return RangeResult::Ignore;
+        }
+
+        if (suffix == 0 || size == 0) {
+            return RangeResult::Unsatisfiable;
+        }
+
+        first = size - std::min(suffix, size);
+        last = size - 1;
+        return RangeResult::Satisfiable;
+    }
+
+    if (!parse_size(from, first)) {
+        return RangeResult::Ignore;
+    }
+
+    last = size > 0 ? size - 1 : 0;
+
+    if (!to.empty()) {
+        std::size_t end = 0;
+
+        if (!parse_size(to, end) || end < first) {
+            return RangeResult::Ignore;
+        }
+
+        last = std::min(end, last);
+    }
+
+    return first < size ? RangeResult::Satisfiable : RangeResult::Unsatisfiable;
+}
+
+void negotiate_file(std::string_view method, const HeaderTable& headers, Response& resp) {
+    if (resp.status != 200 || (method != "GET" && method != "HEAD")) {
+        return;
+    }
+
+    const MappedFile& file = *resp.file;
+    std::string_view none_match = find_header(headers, "If-None-Match");
+
+    // If-Modified-Since is compared exactly against the date we sent
+    bool not_modified = !none_match.empty() ? etag_matches(none_match, file.etag)
+                                            : find_header(headers, "If-Modified-Since") == file.last_modified;
+
+    if (not_modified) {
+        resp.status = 304;
+        resp.file.reset();
+        resp.file_length = 0;
+        return;
+    }
+
+    std::string_view range = find_header(headers, "Range");
+    std::string_view if_range = find_header(headers, "If-Range");
+
+    if (range.empty() || method != "GET" ||
+        (!if_range.empty() && if_range != file.etag && if_range != file.last_modified)) {
+        return;
+    }
+
+    std::size_t first = 0;
+    std::size_t last = 0;
+    RangeResult result = parse_range(range, file.size, first, last);
+
+    if (result == RangeResult::Ignore) {
         return;
     }
 
-    std::cout << "HTTP server listening on port " << port << std::endl;
+    resp.headers += "Content-Range: bytes ";
+
+    if (result == RangeResult::Unsatisfiable) {
+        resp.status = 416;
+        resp.headers += '*';
+        resp.file.reset();
+        resp.file_length = 0;
+    } else {
+        resp.status = 206;
+        append_number(resp.headers, first);
+        resp.headers += '-';
+        append_number(resp.headers, last);
+        resp.file_offset = first;
+        resp.file_length = last - first + 1;
+    }
+
+    resp.headers += '/';
+    append_number(resp.headers, file.size);
+    resp.headers += "\r\n";
+}
+
+/**
+ * True unless an Accept-Encoding element's parameters give it q=0.
+ */
+static bool q_nonzero(std::string_view params) {
+    while (!params.empty()) {
+        std::size_t semi = std::min(params.find(';'), params.size());
+        std::string_view param = trim(params.substr(0, semi));
+        params.remove_prefix(std::min(semi + 1, params.size()));
+
+        if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+            return param.substr(2).find_first_of("123456789") != std::string_view::npos;
+        }
+    }
+
+    return true;
+}
 
-    while (true) {
-        boost::system::error_code ec;
-        boost::asio::ip::tcp::socket socket(bishop::rt::io_context());
+Encoding accepted_encoding(std::string_view accept_encoding) {
+    // Explicitly listed codings override "*"
+    int gzip = -1;
+    int deflate = -1;
+    int any = -1;
 
-        // Yield fiber during accept
-        acceptor.async_accept(socket, boost::fibers::asio::yield[ec]);
+    while (!accept_encoding.empty()) {
+        std::size_t comma = std::min(accept_encoding.find(','), accept_encoding.size());
+        std::string_view item = accept_encoding.substr(0, comma);
+        accept_encoding.remove_prefix(std::min(comma + 1, accept_encoding.size()));
 
-        if (!ec) {
-            auto self = this;
+        std::size_t semi = std::min(item.find(';'), item.size());
+        std::string_view coding = trim(item.substr(0, semi));
+        int allowed = q_nonzero(item.substr(std::min(semi + 1, item.size()))) ? 1 : 0;
 
-            // Spawn handler as go routine (fiber)
-            boost::fibers::fiber([self, socket = std::move(socket)]() mutable {
-                handle_connection(std::move(socket), [self](const Request& req) {
-                    return self->route(req);
-                });
-            }).detach();
+        if (iequals(coding, "gzip") || iequals(coding, "x-gzip")) {
+            gzip = allowed;
+        } else if (iequals(coding, "deflate")) {
+            deflate = allowed;
+        } else if (coding == "*") {
+            any = allowed;
         }
     }
+
+    if (gzip == 1 || (gzip == -1 && any == 1)) {
+        return Encoding::Gzip;
+    }
+
+    if (deflate == 1 || (deflate == -1 && any == 1)) {
+        return Encoding::Deflate;
+    }
+
+    return Encoding::Identity;
+}
+
+/**
+ * Content-Type prefixes worth compressing. Images other than SVG, fonts
+ * and archives are compressed already.
+ */
+static constexpr std::string_view COMPRESSIBLE_TYPES[] = {
+    "text/",
+    "application/json",
+    "application/javascript",
+    "application/xml",
+    "application/wasm",
+    "image/svg+xml",
+};
+
+bool compressible(std::string_view content_type) {
+    std::string_view type = trim(content_type.substr(0, std::min(content_type.find(';'), content_type.size())));
+
+    for (std::string_view prefix : COMPRESSIBLE_TYPES) {
+        if (type.size() >= prefix.size() && iequals(type.substr(0, prefix.size()), prefix)) {
+            return true;
+        }
+    }
+
+    // Structured syntax suffixes, as in application/problem+json
+    return type.ends_with("+json") || type.ends_with("+xml");
+}
+
+std::string compress(std::string_view data, Encoding encoding, int level) {
+    if (data.size() > std::numeric_limits<uInt>::max()) {
+        return {};
+    }
+
+    // Window bits past 15 ask zlib for a gzip wrapper. HTTP's "deflate"
+    // is the zlib wrapper, which plain MAX_WBITS gives
+    z_stream zs{};
+    int window_bits = encoding == Encoding::Gzip ? MAX_WBITS + 16 : MAX_WBITS;
+
+    if (deflateInit2(&zs, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return {};
+    }
+
+    // deflateBound() is enough for a single Z_FINISH call
+    std::string out(deflateBound(&zs, static_cast<uLong>(data.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(std::min<std::size_t>(out.size(), std::numeric_limits<uInt>::max()));
+
+    int result = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return result == Z_STREAM_END ? out : std::string{};
+}
+
+/**
+ * Inflates data with the given window bits into out, stopping and setting
+ * too_large once out would pass max_bytes. Returns zlib's last result.
+ */
+static int inflate_into(std::string_view data, int window_bits, std::size_t max_bytes, std::string& out,
+                        bool& too_large) {
+    z_stream zs{};
+
+    if (inflateInit2(&zs, window_bits) != Z_OK) {
+        return Z_MEM_ERROR;
+    }
+
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    out.clear();
+    int result = Z_OK;
+    char chunk[16384];
+
+    while (result == Z_OK) {
+        zs.next_out = reinterpret_cast<Bytef*>(chunk);
+        zs.avail_out = sizeof(chunk);
+        result = inflate(&zs, Z_NO_FLUSH);
+        std::size_t produced = sizeof(chunk) - zs.avail_out;
+
+        if (max_bytes > 0 && out.size() + produced > max_bytes) {
+            too_large = true;
+            break;
+        }
+
+        out.append(chunk, produced);
+    }
+
+    inflateEnd(&zs);
+    return result;
+}
+
+std::string decompress(std::string_view data, Encoding encoding, std::size_t max_bytes, std::string& out) {
+    if (data.size() > std::numeric_limits<uInt>::max()) {
+        return "body too large to decode";
+    }
+
+    bool too_large = false;
+    int window_bits = encoding == Encoding::Gzip ? MAX_WBITS + 16 : MAX_WBITS;
+    int result = inflate_into(data, window_bits, max_bytes, out, too_large);
+
+    // Many servers send "deflate" as a raw deflate stream, with no zlib
+    // header, which the zlib wrapper rejects as a data error
+    if (result == Z_DATA_ERROR && encoding == Encoding::Deflate) {
+        result = inflate_into(data, -MAX_WBITS, max_bytes, out, too_large);
+    }
+
+    if (too_large) {
+        return "decoded body larger than " + std::to_string(max_bytes) + " bytes";
+    }
+
+    if (result == Z_STREAM_END) {
+        return "";
+    }
+
+    return encoding == Encoding::Gzip ? "invalid gzip body" : "invalid deflate body";
+}
+
+constexpr std::string_view VARY_ACCEPT_ENCODING = "Vary: Accept-Encoding\r\n";
+
+static std::string_view content_encoding(Encoding encoding) {
+    return encoding == Encoding::Gzip ? "Content-Encoding: gzip\r\n" : "Content-Encoding: deflate\r\n";
+}
+
+/**
+ * Compresses data, on the offload pool if it is at least
+ * http_compress_offload_bytes, so a large body does not hold up the
+ * other fibers on this thread.
+ */
+static std::string compress_body(std::string_view data, Encoding encoding, int level) {
+    std::size_t offload_bytes = bishop::rt::http_compress_offload_bytes();
+
+    if (offload_bytes > 0 && data.size() >= offload_bytes) {
+        return bishop::rt::offload([data, encoding, level]() {
+            return compress(data, encoding, level);
+        });
+    }
+
+    return compress(data, encoding, level);
+}
+
+/**
+ * Swaps a cached response for its compressed form, serialized like the
+ * entry but with the encoded body's length and encoding headers.
+ */
+static void encode_cached(Encoding encoding, Response& resp) {
+    const CachedResponse& entry = *resp.cached;
+    std::shared_ptr<const CachedResponse> form = entry.encoded.find(encoding);
+
+    if (!form) {
+        // Kept forms are compressed once, so they get zlib's best level
+        Response shape{200, entry.content_type, compress_body(entry.body, encoding, Z_BEST_COMPRESSION)};
+        auto made = std::make_shared<CachedResponse>();
+
+        // A failed compression, or one no smaller than the body, is kept
+        // as a form with no head, so later hits send the entry as it is
+        if (!shape.body.empty() && shape.body.size() < entry.body.size()) {
+            shape.headers = entry.headers;
+            shape.headers += VARY_ACCEPT_ENCODING;
+            shape.headers += content_encoding(encoding);
+
+            append_fields(made->head, shape);
+            made->body = std::move(shape.body);
+            made->content_type = entry.content_type;
+            made->headers = std::move(shape.headers);
+            made->expires = entry.expires;
+        }
+
+        form = entry.encoded.keep(encoding, std::move(made));
+    }
+
+    if (form->head.empty()) {
+        resp.headers += VARY_ACCEPT_ENCODING;
+        return;
+    }
+
+    resp.cached = std::move(form);
+}
+
+/**
+ * Sends a whole-file response from the file's compressed form. The ETag
+ * is weakened, since the bytes differ from the file's, and ranges are no
+ * longer offered.
+ */
+static void encode_file(Encoding encoding, Response& resp) {
+    const MappedFile& file = *resp.file;
+    std::shared_ptr<const std::string> form = file.encoded.find(encoding);
+
+    if (!form) {
+        std::string body = compress_body(std::string_view(file.data, file.size), encoding, Z_BEST_COMPRESSION);
+        form = file.encoded.keep(encoding, std::make_shared<const std::string>(std::move(body)));
+    }
+
+    // A failed compression is kept too, so it is not retried. So is one
+    // no smaller than the file, which is sent as it is
+    if (form->empty() || form->size() >= file.size) {
+        return;
+    }
+
+    constexpr std::string_view ETAG = "ETag: \"";
+    constexpr std::string_view ACCEPT_RANGES = "Accept-Ranges: bytes\r\n";
+    std::size_t etag = resp.headers.find(ETAG);
+
+    if (etag != std::string::npos) {
+        resp.headers.insert(etag + ETAG.size() - 1, "W/");
+    }
+
+    std::size_t ranges = resp.headers.find(ACCEPT_RANGES);
+
+    if (ranges != std::string::npos) {
+        resp.headers.erase(ranges, ACCEPT_RANGES.size());
+    }
+
+    resp.headers += content_encoding(encoding);
+    resp.encoded = std::move(form);
+    resp.file.reset();
+    resp.file_length = 0;
+}
+
+void negotiate_encoding(const HeaderTable& headers, Response& resp) {
+    std::size_t min_bytes = bishop::rt::http_compress_min_bytes();
+
+    if (min_bytes == 0 || resp.streamed) {
+        return;
+    }
+
+    std::size_t size = 0;
+    std::string_view content_type;
+
+    if (resp.cached) {
+        size = resp.cached->body.size();
+        content_type = resp.cached->content_type;
+    } else if (resp.file) {
+        // Only whole files; a 206's validators and offsets are the file's
+        if (resp.status != 200 || resp.file_length != resp.file->size) {
+            return;
+        }
+
+        size = resp.file_length;
+        content_type = resp.content_type;
+    } else {
+        size = resp.body.size();
+        content_type = resp.content_type;
+    }
+
+    if (size < min_bytes || resp.status == 204 || resp.status == 304 || !compressible(content_type)) {
+        return;
+    }
+
+    Encoding encoding = accepted_encoding(find_header(headers, "Accept-Encoding"));
+
+    if (encoding == Encoding::Identity) {
+        resp.headers += VARY_ACCEPT_ENCODING;
+        return;
+    }
+
+    if (resp.cached) {
+        encode_cached(encoding, resp);
+        return;
+    }
+
+    resp.headers += VARY_ACCEPT_ENCODING;
+
+    if (resp.file) {
+        encode_file(encoding, resp);
+        return;
+    }
+
+    std::string body = compress_body(resp.body, encoding, Z_DEFAULT_COMPRESSION);
+
+    if (!body.empty() && body.size() < resp.body.size()) {
+        resp.body = std::move(body);
+        resp.headers += content_encoding(encoding);
+    }
+}
+
+}  // namespace detail
+
+Response file(const std::string& path) {
+    std::shared_ptr<const MappedFile> mapped = detail::map_file(path);
+
+    if (!mapped) {
+        return not_found();
+    }
+
+    Response resp{200, std::string(detail::mime_type(path)), ""};
+    resp.headers.reserve(96);
+    resp.headers += "ETag: ";
+    resp.headers += mapped->etag;
+    resp.headers += "\r\nLast-Modified: ";
+    resp.headers += mapped->last_modified;
+    resp.headers += "\r\nAccept-Ranges: bytes\r\n";
+    resp.file_length = mapped->size;
+    resp.file = std::move(mapped);
+    return resp;
+}
+
+std::string format_response(const Response& resp, bool keep_alive) {
+    std::string response;
+    detail::append_head(response, resp, keep_alive);
+
+    if (resp.file) {
+        response.append(resp.file->data + resp.file_offset, resp.file_length);
+    } else if (resp.encoded) {
+        response += *resp.encoded;
+    } else {
+        response += resp.body;
+    }
+
+    return response;
+}
+
+namespace detail {
+
+/**
+ * A closed connection's read buffer and write queue, kept for reuse.
+ */
+struct ConnectionBuffers {
+    std::vector<char> read;
+    std::vector<Outgoing> out;
+    std::vector<boost::asio::const_buffer> gather;
+};
+
+constexpr std::size_t BUFFER_POOL_SIZE = 256;
+
+/**
+ * Free connection buffers on this thread. A fiber may close its
+ * connection on a different thread than it opened it on; the buffers
+ * then simply join that thread's pool.
+ */
+static thread_local std::vector<ConnectionBuffers> t_buffer_pool;
+
+}  // namespace detail
+
+Connection::Connection(boost::asio::ip::tcp::socket socket) :
+    socket_(std::move(socket)),
+    timer_(socket_.get_executor()) {
+    llhttp_init(&parser_, HTTP_REQUEST, &detail::parser_settings());
+    parser_.data = &ctx_;
+
+    if (!detail::t_buffer_pool.empty()) {
+        detail::ConnectionBuffers& pooled = detail::t_buffer_pool.back();
+        buffer_.swap(pooled.read);
+        out_.swap(pooled.out);
+        gather_.swap(pooled.gather);
+        detail::t_buffer_pool.pop_back();
+    } else {
+        buffer_.resize(READ_SIZE);
+    }
+}
+
+Connection::~Connection() {
+    // A read buffer grown for a large head is not worth keeping
+    if (buffer_.size() != READ_SIZE || detail::t_buffer_pool.size() >= detail::BUFFER_POOL_SIZE) {
+        return;
+    }
+
+    for (detail::Outgoing& out : out_) {
+        out.resp = Response{};
+    }
+
+    gather_.clear();
+    detail::t_buffer_pool.push_back({std::move(buffer_), std::move(out_), std::move(gather_)});
+}
+
+bool Connection::next(Request& req) {
+    head_request_ = false;
+    ctx_.method.clear();
+    ctx_.url.clear();
+    ctx_.body.clear();
+    ctx_.headers.clear();
+    ctx_.body_size = 0;
+    ctx_.in_value = false;
+    ctx_.headers_complete = false;
+    ctx_.message_complete = false;
+    body_failed_ = false;
+    stream_ = Stream::None;
+    stream_pending_.clear();
+    req.params.clear();
+    request_started_ = false;
+
+    // Pipelined bytes are the start of this request
+    if (begin_ < end_) {
+        start_request();
+    }
+
+    while (!ctx_.headers_complete) {
+        if (!parse_some()) {
+            return false;
+        }
+    }
+
+    if (head_size() > bishop::rt::http_max_header_bytes()) {
+        send(Response{431, "text/plain", "Request Header Fields Too Large"}, false);
+        return false;
+    }
+
+    std::size_t buffer_bytes = bishop::rt::http_body_buffer_bytes();
+
+    while (!ctx_.message_complete && !body_too_large() && body_length() <= buffer_bytes) {
+        if (!parse_some()) {
+            return false;
+        }
+    }
+
+    head_request_ = ctx_.method == "HEAD";
+
+    if (body_too_large()) {
+        send(Response{413, "text/plain", "Payload Too Large"}, false);
+        return false;
+    }
+
+    // The method stays in ctx_ too, for negotiate_file() after the
+    // request has been moved into the handler; it fits in SSO
+    req.method = ctx_.method;
+    req.path = std::move(ctx_.url);
+    req.connection = this;
+    req.body_read = false;
+
+    if (ctx_.message_complete) {
+        req.body = std::move(ctx_.body);
+        req.body_stream = nullptr;
+    } else {
+        // Later reads move the head to the front of the buffer; move it
+        // now, before the request copies its header views
+        std::size_t keep = 0;
+
+        if (!ctx_.headers.empty() && !keep_head(keep)) {
+            return false;
+        }
+
+        begin_ = keep;
+        end_ = keep;
+        req.body.clear();
+        req.body_stream = this;
+    }
+
+    req.headers = ctx_.headers;
+    return true;
+}
+
+/**
+ * Parses the buffered bytes, or if there are none, flushes queued
+ * responses and reads more. Returns false on a malformed request, a
+ * closed connection or the idle timeout.
+ */
+bool Connection::parse_some() {
+    if (begin_ == end_) {
+        return flush() && read_some();
+    }
+
+    const char* data = buffer_.data() + begin_;
+    llhttp_errno err = llhttp_execute(&parser_, data, end_ - begin_);
+
+    if (err == HPE_PAUSED) {
+        // Paused after one request; anything left is pipelined
+        begin_ = static_cast<std::size_t>(llhttp_get_error_pos(&parser_) - buffer_.data());
+        llhttp_resume(&parser_);
+        return true;
+    }
+
+    begin_ = 0;
+    end_ = 0;
+    return err == HPE_OK;
+}
+
+std::string Connection::read_body() {
+    while (ctx_.body.empty() && !ctx_.message_complete && !body_failed_) {
+        body_failed_ = !parse_some() || body_too_large();
+    }
+
+    if (body_failed_) {
+        return "";
+    }
+
+    std::string chunk = std::move(ctx_.body);
+    ctx_.body.clear();
+    return chunk;
+}
+
+bool Connection::body_complete() const {
+    return ctx_.message_complete;
+}
+
+/**
+ * Returns the current request's Content-Length once its head is parsed.
+ * A chunked body shows its length only as it arrives, so for one this
+ * is the bytes parsed so far.
+ */
+std::uint64_t Connection::body_length() const {
+    // llhttp counts content_length down as the body is parsed
+    if (parser_.flags & F_CHUNKED) {
+        return ctx_.body_size;
+    }
+
+    return ctx_.body_size + parser_.content_length;
+}
+
+bool Connection::body_too_large() const {
+    std::size_t max = bishop::rt::http_max_body_bytes();
+    return max > 0 && body_length() > max;
+}
+
+bool Connection::keep_alive() const {
+    return ctx_.keep_alive;
+}
+
+void Connection::negotiate_file(Response& resp) const {
+    detail::negotiate_file(ctx_.method, ctx_.headers, resp);
+}
+
+void Connection::negotiate_encoding(Response& resp) const {
+    detail::negotiate_encoding(ctx_.headers, resp);
+}
+
+void Connection::send(Response resp, bool keep_alive) {
+    if (out_count_ == out_.size()) {
+        out_.emplace_back();
+    }
+
+    detail::Outgoing& out = out_[out_count_++];
+    out.head.clear();
+    out.head_only = head_request_;
+
+    // A cached response is already serialized up to its Connection header
+    if (resp.cached) {
+        out.head += resp.headers;
+        out.head += keep_alive ? detail::KEEP_ALIVE : detail::CLOSE;
+    } else {
+        detail::append_head(out.head, resp, keep_alive);
+    }
+
+    out.resp = std::move(resp);
+}
+
+bool Connection::flush() {
+    if (out_count_ == 0) {
+        return true;
+    }
+
+    gather_.clear();
+    gather_queued();
+    return write_gathered();
+}
+
+/**
+ * Appends the head and body of every queued response to gather_.
+ */
+void Connection::gather_queued() {
+    for (std::size_t i = 0; i < out_count_; i++) {
+        const Response& resp = out_[i].resp;
+
+        if (resp.cached) {
+            gather_.push_back(boost::asio::buffer(resp.cached->head));
+            gather_.push_back(boost::asio::buffer(out_[i].head));
+
+            if (!resp.cached->body.empty() && !out_[i].head_only) {
+                gather_.push_back(boost::asio::buffer(resp.cached->body));
+            }
+
+            continue;
+        }
+
+        gather_.push_back(boost::asio::buffer(out_[i].head));
+
+        if (out_[i].head_only) {
+            continue;
+        }
+
+        if (resp.file && resp.file_length > 0) {
+            gather_.push_back(boost::asio::buffer(resp.file->data + resp.file_offset, resp.file_length));
+        } else if (resp.encoded) {
+            gather_.push_back(boost::asio::buffer(*resp.encoded));
+        } else if (!resp.body.empty()) {
+            gather_.push_back(boost::asio::buffer(resp.body));
+        }
+    }
+}
+
+/**
+ * Writes gather_ with one async_write, then releases the queued bodies.
+ */
+bool Connection::write_gathered() {
+    boost::system::error_code ec;
+    expire_after(bishop::rt::http_write_timeout_ms());
+    boost::asio::async_write(socket_, gather_, boost::fibers::asio::yield[ec]);
+    set_deadline(std::chrono::steady_clock::time_point::max());
+
+    // Release the bodies; the heads keep their buffers for reuse
+    for (std::size_t i = 0; i < out_count_; i++) {
+        out_[i].resp = Response{};
+    }
+
+    out_count_ = 0;
+    return !ec;
+}
+
+void Connection::begin_stream(int status, std::string_view content_type) {
+    if (stream_ != Stream::None) {
+        return;
+    }
+
+    stream_chunked_ = parser_.http_major > 1 || (parser_.http_major == 1 && parser_.http_minor >= 1);
+    stream_keep_alive_ = stream_chunked_ && body_complete() && keep_alive();
+    stream_ = Stream::Open;
+
+    Response head{status, std::string(content_type), ""};
+    head.streamed = true;
+
+    if (stream_chunked_) {
+        head.headers = "Transfer-Encoding: chunked\r\n";
+    }
+
+    send(std::move(head), stream_keep_alive_);
+}
+
+bool Connection::write_chunk(std::string_view data) {
+    if (stream_ != Stream::Open) {
+        return false;
+    }
+
+    if (data.size() < STREAM_COPY_BYTES && stream_pending_.size() + data.size() < STREAM_FLUSH_BYTES) {
+        stream_pending_.append(data);
+        return true;
+    }
+
+    return write_stream(data, false);
+}
+
+bool Connection::flush_stream() {
+    return stream_ == Stream::Open && write_stream({}, false);
+}
+
+bool Connection::finish_stream() {
+    if (stream_ == Stream::Open) {
+        write_stream({}, true);
+    }
+
+    return stream_ == Stream::Ended && stream_keep_alive_;
+}
+
+bool Connection::streaming() const {
+    return stream_ != Stream::None;
+}
+
+/**
+ * Sends the queued responses, then the pending body bytes and data as one
+ * chunk, then the last-chunk marker if last. data is written in place.
+ */
+bool Connection::write_stream(std::string_view data, bool last) {
+    static constexpr std::string_view CRLF = "\r\n";
+    static constexpr std::string_view LAST_CHUNK = "0\r\n\r\n";
+
+    gather_.clear();
+    gather_queued();
+
+    // A streamed response to HEAD sends only its head
+    if (head_request_) {
+        stream_pending_.clear();
+        data = {};
+    }
+
+    std::size_t size = stream_pending_.size() + data.size();
+
+    if (size > 0) {
+        if (stream_chunked_) {
+            char* end = std::to_chars(chunk_size_, chunk_size_ + sizeof(chunk_size_) - 2, size, 16).ptr;
+            *end++ = '\r';
+            *end++ = '\n';
+            gather_.push_back(boost::asio::buffer(chunk_size_, end - chunk_size_));
+        }
+
+        if (!stream_pending_.empty()) {
+            gather_.push_back(boost::asio::buffer(stream_pending_));
+        }
+
+        if (!data.empty()) {
+            gather_.push_back(boost::asio::buffer(data.data(), data.size()));
+        }
+
+        if (stream_chunked_) {
+            gather_.push_back(boost::asio::buffer(CRLF.data(), CRLF.size()));
+        }
+    }
+
+    if (last && stream_chunked_ && !head_request_) {
+        gather_.push_back(boost::asio::buffer(LAST_CHUNK.data(), LAST_CHUNK.size()));
+    }
+
+    if (gather_.empty()) {
+        if (last) {
+            stream_ = Stream::Ended;
+        }
+
+        return true;
+    }
+
+    bool ok = write_gathered();
+    stream_pending_.clear();
+
+    if (!ok) {
+        stream_ = Stream::Failed;
+    } else if (last) {
+        stream_ = Stream::Ended;
+    }
+
+    return ok;
+}
+
+/**
+ * Returns the bytes of the current request's head seen so far: its URL
+ * and the span of its header views.
+ */
+std::size_t Connection::head_size() const {
+    if (ctx_.headers.empty()) {
+        return ctx_.url.size();
+    }
+
+    const char* first = ctx_.headers.front().name.data();
+    const Header& last = ctx_.headers.back();
+    const char* last_end = last.value.empty() ? last.name.data() + last.name.size()
+                                              : last.value.data() + last.value.size();
+    return ctx_.url.size() + static_cast<std::size_t>(last_end - first);
+}
+
+/**
+ * Moves the bytes the current request's header views point at to the
+ * front of the buffer, growing it if little room is left, and re-points
+ * the views. Sets keep to the number of bytes kept; returns false if the
+ * head has outgrown http_max_header_bytes.
+ */
+bool Connection::keep_head(std::size_t& keep) {
+    if (head_size() > bishop::rt::http_max_header_bytes()) {
+        return false;
+    }
+
+    const char* first = ctx_.headers.front().name.data();
+    keep = head_size() - ctx_.url.size();
+    std::vector<char> grown;
+
+    if (buffer_.size() - keep < READ_SIZE / 4) {
+        grown.resize(buffer_.size() * 2);
+        std::memcpy(grown.data(), first, keep);
+    } else {
+        std::memmove(buffer_.data(), first, keep);
+    }
+
+    char* base = grown.empty() ? buffer_.data() : grown.data();
+
+    auto relocate = [first, base](std::string_view& view) {
+        if (!view.empty()) {
+            view = std::string_view(base + (view.data() - first), view.size());
+        }
+    };
+
+    for (Header& h : ctx_.headers) {
+        relocate(h.name);
+        relocate(h.value);
+    }
+
+    if (!grown.empty()) {
+        buffer_.swap(grown);
+    }
+
+    return true;
+}
+
+/**
+ * Records that the current request has begun, starting the clock on its
+ * head.
+ */
+void Connection::start_request() {
+    int timeout_ms = bishop::rt::http_header_timeout_ms();
+    request_started_ = true;
+    head_deadline_ = timeout_ms > 0 ? std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms)
+                                    : std::chrono::steady_clock::time_point::max();
+}
+
+/**
+ * Sets the deadline for the pending read or write; time_point::max()
+ * means none. Pushing a deadline later only stores it, and the timer
+ * re-arms itself for it when it fires early, so the common case of one
+ * deadline per read costs no timer operation. Only an earlier deadline
+ * re-arms the timer.
+ */
+void Connection::set_deadline(std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+
+    if (deadline != std::chrono::steady_clock::time_point::max() &&
+        (!timer_armed_ || deadline < timer_.expiry())) {
+        arm_timer();
+    }
+}
+
+/**
+ * Sets the deadline timeout_ms from now, or none if timeout_ms is 0.
+ */
+void Connection::expire_after(int timeout_ms) {
+    set_deadline(timeout_ms > 0 ? std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms)
+                                : std::chrono::steady_clock::time_point::max());
+}
+
+/**
+ * Arms the timer for deadline_. When it fires past the deadline it cancels
+ * the socket's pending I/O; before it, it re-arms for the moved deadline.
+ *
+ * The handler shares deadline_, timer_armed_ and socket_ with the
+ * connection's fiber without a lock. That is safe because accept_loop()
+ * pins the fiber to the thread whose io_context runs the handler, so the
+ * two never run at once.
+ */
+void Connection::arm_timer() {
+    timer_armed_ = true;
+    timer_.expires_at(deadline_);
+
+    // Re-arming aborts the previous wait, and the expiry may already be
+    // queued when the connection is destroyed, so the handler checks both
+    timer_.async_wait([this, alive = std::weak_ptr<bool>(alive_)](const boost::system::error_code& ec) {
+        if (ec || alive.expired()) {
+            return;
+        }
+
+        timer_armed_ = false;
+
+        if (std::chrono::steady_clock::now() >= deadline_) {
+            boost::system::error_code ignored;
+            socket_.cancel(ignored);
+        } else if (deadline_ != std::chrono::steady_clock::time_point::max()) {
+            arm_timer();
+        }
+    });
+}
+
+/**
+ * Reads more of the request, yielding the fiber until data arrives. All
+ * buffered bytes have been parsed by now; only those under the current
+ * request's header views are kept. The read fails if it misses the
+ * deadline for the request's current phase.
+ */
+bool Connection::read_some() {
+    std::size_t keep = 0;
+
+    if (!ctx_.headers.empty() && !keep_head(keep)) {
+        return false;
+    }
+
+    if (ctx_.headers_complete) {
+        expire_after(bishop::rt::http_body_timeout_ms());
+    } else if (request_started_) {
+        set_deadline(head_deadline_);
+    } else {
+        expire_after(bishop::rt::http_idle_timeout_ms());
+    }
+
+    boost::system::error_code ec;
+    std::size_t n = socket_.async_read_some(boost::asio::buffer(buffer_.data() + keep, buffer_.size() - keep),
+                                            boost::fibers::asio::yield[ec]);
+    set_deadline(std::chrono::steady_clock::time_point::max());
+
+    if (ec) {
+        return false;
+    }
+
+    if (!request_started_) {
+        start_request();
+    }
+
+    begin_ = keep;
+    end_ = keep + n;
+    return true;
+}
+
+namespace detail {
+
+static boost::fibers::mutex slots_mutex;
+static boost::fibers::condition_variable slots_free;
+static int slots_used = 0;
+
+ConnectionSlot::ConnectionSlot() {
+    int max = bishop::rt::http_max_connections();
+
+    if (max <= 0) {
+        return;
+    }
+
+    std::unique_lock<boost::fibers::mutex> lock(slots_mutex);
+    slots_free.wait(lock, [max]() { return slots_used < max; });
+    slots_used++;
+    held_ = true;
+}
+
+ConnectionSlot::~ConnectionSlot() {
+    if (!held_) {
+        return;
+    }
+
+    {
+        std::lock_guard<boost::fibers::mutex> lock(slots_mutex);
+        slots_used--;
+    }
+
+    slots_free.notify_one();
+}
+
+}  // namespace detail
+
+void Router::add(std::string_view method, std::string_view pattern, Handler handler) {
+    Node* root = nullptr;
+
+    for (auto& [tree_method, tree] : trees_) {
+        if (tree_method == method) {
+            root = tree.get();
+        }
+    }
+
+    if (!root) {
+        trees_.emplace_back(std::string(method), std::make_unique<Node>());
+        root = trees_.back().second.get();
+    }
+
+    handlers_.push_back(std::move(handler));
+    insert(*root, pattern, static_cast<int>(handlers_.size() - 1));
+}
+
+/**
+ * Inserts the rest of a pattern below node, whose own text already matched.
+ */
+void Router::insert(Node& node, std::string_view pattern, int handler) {
+    if (pattern.empty()) {
+        if (node.handler < 0) {
+            node.handler = handler;
+        }
+
+        return;
+    }
+
+    if (pattern[0] == ':' || pattern[0] == '*') {
+        bool is_param = pattern[0] == ':';
+        std::size_t end = is_param ? std::min(pattern.find('/'), pattern.size()) : pattern.size();
+        std::string name(pattern.substr(1, end - 1));
+
+        if (!is_param && name.empty()) {
+            name = "*";
+        }
+
+        std::unique_ptr<Node>& child = is_param ? node.param : node.wildcard;
+
+        if (!child) {
+            child = std::make_unique<Node>();
+            child->name = name;
+        } else if (child->name != name) {
+            throw std::invalid_argument("route parameter '" + name + "' conflicts with '" +
+                                        child->name + "' at the same position");
+        }
+
+        insert(*child, pattern.substr(end), handler);
+        return;
+    }
+
+    std::size_t end = std::min(pattern.find_first_of(":*"), pattern.size());
+    std::string_view text = pattern.substr(0, end);
+    std::size_t slot = node.indices.find(text[0]);
+
+    if (slot == std::string::npos) {
+        auto child = std::make_unique<Node>();
+        child->prefix = std::string(text);
+        node.indices.push_back(text[0]);
+        node.children.push_back(std::move(child));
+        insert(*node.children.back(), pattern.substr(end), handler);
+        return;
+    }
+
+    Node& child = *node.children[slot];
+    std::size_t common = 0;
+
+    while (common < child.prefix.size() && common < text.size() &&
+           child.prefix[common] == text[common]) {
+        common++;
+    }
+
+    if (common < child.prefix.size()) {
+        // Split the child at the first differing byte
+        auto tail = std::make_unique<Node>();
+        tail->prefix = child.prefix.substr(common);
+        tail->indices = std::move(child.indices);
+        tail->children = std::move(child.children);
+        tail->param = std::move(child.param);
+        tail->wildcard = std::move(child.wildcard);
+        tail->handler = child.handler;
+
+        child.prefix.resize(common);
+        child.indices = std::string(1, tail->prefix[0]);
+        child.children.clear();
+        child.children.push_back(std::move(tail));
+        child.handler = -1;
+    }
+
+    insert(child, pattern.substr(common), handler);
+}
+
+const Router::Handler* Router::match(Request& req) const {
+    for (const auto& [method, tree] : trees_) {
+        if (method == req.method) {
+            req.params.clear();
+
+            const Node* node = find(*tree, route_path(req), 0, req);
+            return node ? &handlers_[node->handler] : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * Matches the rest of the path below node, whose own text already matched.
+ * offset is the position of path in req.path, for recording params.
+ */
+const Router::Node* Router::find(const Node& node, std::string_view path, std::size_t offset,
+                                 Request& req) const {
+    if (path.empty() && node.handler >= 0) {
+        return &node;
+    }
+
+    if (!path.empty()) {
+        std::size_t slot = node.indices.find(path[0]);
+
+        if (slot != std::string::npos) {
+            const Node& child = *node.children[slot];
+
+            if (path.substr(0, child.prefix.size()) == child.prefix) {
+                std::size_t n = child.prefix.size();
+
+                if (const Node* found = find(child, path.substr(n), offset + n, req)) {
+                    return found;
+                }
+            }
+        }
+
+        if (node.param) {
+            std::size_t n = std::min(path.find('/'), path.size());
+
+            if (n > 0) {
+                req.params.push_back(Param{node.param->name, offset, n});
+
+                if (const Node* found = find(*node.param, path.substr(n), offset + n, req)) {
+                    return found;
+                }
+
+                req.params.pop_back();
+            }
+        }
+    }
+
+    if (node.wildcard && node.wildcard->handler >= 0) {
+        req.params.push_back(Param{node.wildcard->name, offset, path.size()});
+        return node.wildcard.get();
+    }
+
+    return nullptr;
+}
+
+void App::get(const std::string& path, std::function<Response(Request)> handler) {
+    router.add("GET", path, std::move(handler));
+}
+
+void App::post(const std::string& path, std::function<Response(Request)> handler) {
+    router.add("POST", path, std::move(handler));
+}
+
+namespace detail {
+
+int ResponseCache::ttl_for(std::string_view path) const {
+    const Rule* best = nullptr;
+
+    for (const Rule& rule : rules) {
+        if (path.starts_with(rule.prefix) && (!best || rule.prefix.size() >= best->prefix.size())) {
+            best = &rule;
+        }
+    }
+
+    return best ? best->ttl_ms : 0;
+}
+
+bool ResponseCache::bypasses(const Request& req) const {
+    for (std::string_view credential : {"Authorization", "Cookie"}) {
+        if (!req.header_view(credential).empty() &&
+            std::none_of(vary.begin(), vary.end(), [credential](const std::string& name) {
+                return iequals(name, credential);
+            })) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ResponseCache::make_key(const Request& req, std::string& key) const {
+    key.clear();
+    key += req.method;
+    key += ' ';
+    key += req.path;
+
+    // NUL cannot occur in a header value, so keys cannot run together
+    for (const std::string& name : vary) {
+        key += '\0';
+        key += req.header_view(name);
+    }
+}
+
+ResponseCache::Shard& ResponseCache::shard(std::string_view key) {
+    return shards_[std::hash<std::string_view>{}(key) % SHARDS];
+}
+
+std::shared_ptr<const CachedResponse> ResponseCache::find(std::string_view key) {
+    Shard& s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(key);
+
+    if (it == s.index.end()) {
+        s.misses++;
+        return nullptr;
+    }
+
+    auto entry = it->second;
+
+    if (std::chrono::steady_clock::now() >= entry->response->expires) {
+        s.bytes -= entry->bytes;
+        s.index.erase(it);
+        s.lru.erase(entry);
+        s.misses++;
+        return nullptr;
+    }
+
+    s.lru.splice(s.lru.begin(), s.lru, entry);
+    s.hits++;
+    return entry->response;
+}
+
+void ResponseCache::insert(std::string_view key, std::shared_ptr<const CachedResponse> response) {
+    std::size_t bytes = key.size() + response->head.size() + response->body.size() + sizeof(Entry);
+    std::size_t limit = max_bytes / SHARDS;
+
+    if (bytes > limit) {
+        return;
+    }
+
+    Shard& s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(key);
+
+    if (it != s.index.end()) {
+        s.bytes -= it->second->bytes;
+        s.lru.erase(it->second);
+        s.index.erase(it);
+    }
+
+    while (s.bytes + bytes > limit) {
+        Entry& victim = s.lru.back();
+        s.bytes -= victim.bytes;
+        s.index.erase(victim.key);
+        s.lru.pop_back();
+    }
+
+    s.lru.push_front(Entry{std::string(key), std::move(response), bytes});
+    s.index.emplace(s.lru.front().key, s.lru.begin());
+    s.bytes += bytes;
+}
+
+std::uint64_t ResponseCache::hits() {
+    std::uint64_t total = 0;
+
+    for (Shard& s : shards_) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        total += s.hits;
+    }
+
+    return total;
+}
+
+std::uint64_t ResponseCache::misses() {
+    std::uint64_t total = 0;
+
+    for (Shard& s : shards_) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        total += s.misses;
+    }
+
+    return total;
+}
+
+/**
+ * Counter value for Bishop's int.
+ */
+static int clamp_count(std::uint64_t count) {
+    return static_cast<int>(std::min<std::uint64_t>(count, std::numeric_limits<int>::max()));
+}
+
+}  // namespace detail
+
+void App::cache(const std::string& prefix, int ttl_ms) {
+    if (!response_cache) {
+        response_cache = std::make_unique<detail::ResponseCache>();
+    }
+
+    response_cache->rules.push_back({prefix, std::max(0, ttl_ms)});
+}
+
+void App::cache_vary(const std::string& header) {
+    if (!response_cache) {
+        response_cache = std::make_unique<detail::ResponseCache>();
+    }
+
+    response_cache->vary.push_back(header);
+}
+
+void App::cache_limit(int max_bytes) {
+    if (!response_cache) {
+        response_cache = std::make_unique<detail::ResponseCache>();
+    }
+
+    response_cache->max_bytes = static_cast<std::size_t>(std::max(0, max_bytes));
+}
+
+int App::cache_hits() {
+    return response_cache ? detail::clamp_count(response_cache->hits()) : 0;
+}
+
+int App::cache_misses() {
+    return response_cache ? detail::clamp_count(response_cache->misses()) : 0;
+}
+
+void App::use(Middleware mw) {
+    middleware.push_back(mw);
+}
+
+Response detail::AppChain::operator()(Request& req) const {
+    // The handler gets a copy, so middleware can still read req once
+    // run() returns
+    if (index == app->middleware.size()) {
+        Request handed = req;
+        return app->dispatch(handed);
+    }
+
+    return app->middleware[index](req, Next<AppChain>{{app, index + 1}});
+}
+
+Response App::route(Request& req) {
+    if (middleware.empty()) {
+        return dispatch(req);
+    }
+
+    return detail::AppChain{this, 0}(req);
+}
+
+Response App::dispatch(Request& req) {
+    int ttl_ms = response_cache && req.method == "GET" && !response_cache->bypasses(req)
+                     ? response_cache->ttl_for(route_path(req))
+                     : 0;
+
+    if (ttl_ms <= 0) {
+        if (const Router::Handler* handler = router.match(req)) {
+            return (*handler)(std::move(req));
+        }
+
+        return not_found();
+    }
+
+    // Hits build the key in a per-thread buffer and allocate nothing. A
+    // miss copies it, since other fibers reuse the buffer while the
+    // handler runs.
+    thread_local std::string scratch;
+    response_cache->make_key(req, scratch);
+
+    if (auto hit = response_cache->find(scratch)) {
+        Response resp{200, "", ""};
+        resp.cached = std::move(hit);
+        return resp;
+    }
+
+    std::string key = scratch;
+    Connection* conn = req.connection;
+    const Router::Handler* handler = router.match(req);
+    Response resp = handler ? (*handler)(std::move(req)) : not_found();
+
+    if (resp.status != 200 || resp.file || resp.streamed || (conn && conn->streaming()) ||
+        sets_cookie(resp)) {
+        return resp;
+    }
+
+    // The body moves into the entry, and this response is sent from it too
+    auto entry = std::make_shared<detail::CachedResponse>();
+    detail::append_fields(entry->head, resp);
+    entry->body = std::move(resp.body);
+    entry->content_type = std::move(resp.content_type);
+    entry->headers = std::move(resp.headers);
+    entry->expires = std::chrono::steady_clock::now() + std::chrono::milliseconds(ttl_ms);
+    response_cache->insert(key, entry);
+
+    Response cached{200, "", ""};
+    cached.cached = std::move(entry);
+    return cached;
+}
+
+void App::listen(int port) {
+    detail::listen_and_serve(port, [this](Request req) {
+        return route(req);
+    });
 }
 
 }  // namespace http
@@ -21,10 +21,21 @@
 // Boost headers for HTTP server functionality
 #include <boost/fiber/all.hpp>
 #include <boost/asio.hpp>
+#include <boost/container/small_vector.hpp>
+#include <bishop/fiber_asio/pooled_stack.hpp>
 #include <bishop/fiber_asio/yield.hpp>
 
 // Additional headers for HTTP
+#include <string_view>
+#include <stdexcept>
+#include <array>
+#include <cstdint>
+#include <list>
+#include <mutex>
 #include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace bishop::rt {
 /**
@@ -39,22 +50,227 @@ boost::asio::io_context& io_context();
 
 namespace http {
 
+/**
+ * A request header. Both views point into the connection's read buffer.
+ */
+struct Header {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * Request headers in arrival order. Typical requests fit inline, so
+ * parsing them allocates nothing.
+ */
+using HeaderTable = boost::container::small_vector<Header, 16>;
+
+/**
+ * A path parameter captured by the router. The name points into the
+ * route table; the value is a range of the request path, so it survives
+ * copies of the request.
+ */
+struct Param {
+    std::string_view name;
+    std::size_t offset = 0;
+    std::size_t size = 0;
+};
+
+class Connection;
+struct Writer;
+
 /**
  * HTTP request structure.
+ *
+ * Header views stay valid until the connection reads its next request,
+ * so a handler that keeps a header beyond its own return must copy it.
+ *
+ * A body no longer than http_body_buffer_bytes arrives in body. A longer
+ * one is left on the connection and read with read_body(), so only the
+ * handler that received the request may read it, and only before it
+ * returns.
  */
 struct Request {
     std::string method;
     std::string path;
     std::string body;
+    HeaderTable headers;
+    boost::container::small_vector<Param, 4> params;
+    Connection* connection = nullptr;    // the connection the request arrived on
+    Connection* body_stream = nullptr;   // set while a long body is still arriving
+    bool body_read = false;              // read_body() has returned the buffered body
+
+    /**
+     * Returns the value of the named header, matched case-insensitively,
+     * or an empty view if the request does not have it.
+     */
+    std::string_view header_view(std::string_view name) const;
+
+    /**
+     * Copy of header_view(name), for Bishop's req.header("name").
+     */
+    std::string header(const std::string& name) const;
+
+    /**
+     * Returns the value of a path parameter captured by the route, such
+     * as "id" for /users/:id or "*" for a bare wildcard, or "" if the
+     * route has no such parameter.
+     */
+    std::string param(const std::string& name) const;
+
+    /**
+     * Returns the next piece of the body, or "" once all of it has been
+     * read. A buffered body is returned whole by the first call; a
+     * streamed one a read buffer at a time, suspending the fiber until
+     * more arrives.
+     */
+    std::string read_body();
+
+    /**
+     * Starts a streamed response on the request's connection and returns
+     * the writer for its body. Whatever the handler then returns is not
+     * sent. Only the handler that received the request may call it.
+     */
+    Writer stream(int status, const std::string& content_type);
 };
 
+/**
+ * Returns the part of the request path that routes match: everything
+ * before the query string.
+ */
+inline std::string_view route_path(const Request& req) {
+    std::string_view path(req.path);
+    return path.substr(0, std::min(path.find('?'), path.size()));
+}
+
+namespace detail {
+
+/**
+ * Content-Codings a response can be compressed with.
+ */
+enum class Encoding { Identity, Gzip, Deflate };
+
+/**
+ * Compressed forms of a file or cached response, made the first time a
+ * client accepts each encoding and kept for later ones. Fibers racing to
+ * make the same form each compress it, and the first one kept wins.
+ */
+template<typename T>
+class EncodedForms {
+public:
+    std::shared_ptr<const T> find(Encoding encoding) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return forms_[slot(encoding)];
+    }
+
+    std::shared_ptr<const T> keep(Encoding encoding, std::shared_ptr<const T> form) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<const T>& kept = forms_[slot(encoding)];
+
+        if (!kept) {
+            kept = std::move(form);
+        }
+
+        return kept;
+    }
+
+private:
+    static std::size_t slot(Encoding encoding) {
+        return encoding == Encoding::Gzip ? 0 : 1;
+    }
+
+    std::mutex mutex_;
+    std::array<std::shared_ptr<const T>, 2> forms_;   // gzip, deflate
+};
+
+}  // namespace detail
+
+/**
+ * A read-only mapping of a file served by http::file(). Mappings are
+ * cached and shared by responses until the file's size or mtime changes.
+ * A file must not be truncated while it is being served.
+ */
+struct MappedFile {
+    const char* data = nullptr;
+    std::size_t size = 0;
+    std::string etag;            // quoted strong validator
+    std::string last_modified;   // HTTP-date
+    std::uint64_t inode = 0;
+    std::int64_t mtime_ns = 0;
+    mutable detail::EncodedForms<std::string> encoded;   // compressed copies of the whole file
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+};
+
+namespace detail {
+
+struct CachedResponse;
+
+}  // namespace detail
+
 /**
  * HTTP response structure.
+ *
+ * A file response sends the bytes [file_offset, file_offset + file_length)
+ * of its mapping instead of body, or its encoded form once compressed. A
+ * cached response sends its entry's serialized head, then headers, then
+ * the entry's body, and the other fields are not used.
  */
 struct Response {
     int status;
     std::string content_type;
     std::string body;
+    std::string headers;   // extra header lines, each ending in "\r\n"
+    std::shared_ptr<const MappedFile> file;
+    std::size_t file_offset = 0;
+    std::size_t file_length = 0;
+    bool streamed = false;   // the body follows the head in pieces, with no Content-Length
+    std::shared_ptr<const std::string> encoded;   // a file's compressed body, sent instead of the mapping
+    std::shared_ptr<const detail::CachedResponse> cached;
+    std::string received;   // header lines of a response read by Client, each ending in "\r\n"
+
+    /**
+     * Returns the value of a header of a response read by Client, such as
+     * Content-Length, matched case-insensitively, or "" if it has none.
+     */
+    std::string header(const std::string& name) const;
+};
+
+/**
+ * Writes the body of a streamed response, returned by Request::stream().
+ *
+ * HTTP/1.1 clients get the body with Transfer-Encoding: chunked; older
+ * ones get it unframed and the connection closes after it. Small writes
+ * are coalesced into larger chunks; a large write is sent straight from
+ * the caller's string. Sending suspends the fiber until the socket takes
+ * the bytes, so a slow client holds back the handler instead of growing
+ * memory. Copies share the connection's stream, so they are cheap.
+ */
+struct Writer {
+    Connection* connection = nullptr;
+    int status = 200;
+    std::string content_type;
+
+    /**
+     * Appends data to the body. Returns false once the client has gone
+     * away, so a producer can stop early.
+     */
+    bool write(const std::string& data);
+
+    /**
+     * Sends everything written so far. Returns false once the client has
+     * gone away.
+     */
+    bool flush();
+
+    /**
+     * Finishes the body and returns a response for the handler to return.
+     * A handler that returns without calling end() has its body finished
+     * for it.
+     */
+    Response end();
 };
 
 /**
@@ -64,7 +280,12 @@ struct HttpParserContext {
     std::string method;
     std::string url;
     std::string body;
+    HeaderTable headers;
+    std::size_t body_size = 0;     // body bytes parsed so far
+    bool in_value = false;    // last header callback was for a value
+    bool headers_complete = false;
     bool message_complete = false;
+    bool keep_alive = false;
 };
 
 namespace detail {
@@ -79,13 +300,30 @@ int on_method(llhttp_t* parser, const char* at, size_t len);
  */
 int on_url(llhttp_t* parser, const char* at, size_t len);
 
+/**
+ * llhttp callback for a header name. Pieces split across reads are
+ * contiguous in the read buffer and extend the same view.
+ */
+int on_header_field(llhttp_t* parser, const char* at, size_t len);
+
+/**
+ * llhttp callback for a header value.
+ */
+int on_header_value(llhttp_t* parser, const char* at, size_t len);
+
+/**
+ * llhttp callback for the end of the head.
+ */
+int on_headers_complete(llhttp_t* parser);
+
 /**
  * llhttp callback for body.
  */
 int on_body(llhttp_t* parser, const char* at, size_t len);
 
 /**
- * llhttp callback for message complete.
+ * llhttp callback for message complete. Pauses the parser so bytes of a
+ * pipelined request after this one stay in the connection buffer.
  */
 int on_message_complete(llhttp_t* parser);
 
@@ -107,55 +345,339 @@ Response json(const std::string& content);
 Response not_found();
 
 /**
- * Formats an HTTP response for sending over the wire.
+ * Creates a 200 OK response that sends the file at path from a cached
+ * memory mapping, with a Content-Type inferred from its extension and
+ * ETag and Last-Modified validators. Conditional and Range requests for
+ * it are answered by the connection. Returns not_found() if path is not
+ * a readable regular file.
  */
-std::string format_response(const Response& resp);
+Response file(const std::string& path);
+
+namespace detail {
 
 /**
- * Reads an HTTP request from a socket (blocking in goroutine context).
+ * Appends the status line and headers for resp, up to and including the
+ * blank line, to head. The Connection header tells the client whether
+ * the connection stays open.
  */
-Request read_request(boost::asio::ip::tcp::socket& socket);
+void append_head(std::string& head, const Response& resp, bool keep_alive);
 
 /**
- * Handle a single connection with a handler.
- * Template must stay in header.
+ * Returns the Content-Type for a file path's extension.
+ */
+std::string_view mime_type(std::string_view path);
+
+/**
+ * Returns the value of the named header, matched case-insensitively, or
+ * an empty view if headers does not have it.
+ */
+std::string_view find_header(const HeaderTable& headers, std::string_view name);
+
+/**
+ * Answers a GET or HEAD of a file response: turns it into 304 Not
+ * Modified when If-None-Match or If-Modified-Since matches the file, and
+ * into 206 Partial Content or 416 for a single-range Range header.
+ */
+void negotiate_file(std::string_view method, const HeaderTable& headers, Response& resp);
+
+/**
+ * Returns the encoding to answer an Accept-Encoding header with: gzip if
+ * the client accepts it, else deflate, else identity.
+ */
+Encoding accepted_encoding(std::string_view accept_encoding);
+
+/**
+ * True for text-like Content-Types that are worth compressing.
+ */
+bool compressible(std::string_view content_type);
+
+/**
+ * Compresses data with a gzip or zlib ("deflate") wrapper at the given
+ * zlib level. Returns "" if zlib fails or data is too large for it.
+ */
+std::string compress(std::string_view data, Encoding encoding, int level);
+
+/**
+ * Inflates gzip or deflate data into out, which may not grow past
+ * max_bytes (0 = no limit). Deflate is read with a zlib wrapper, or as a
+ * raw stream if it has none. Returns an error message, or "" on success.
+ */
+std::string decompress(std::string_view data, Encoding encoding, std::size_t max_bytes, std::string& out);
+
+/**
+ * Compresses resp for a request with the given headers, once compression
+ * is enabled with http_compress_min_bytes. A body at least that large,
+ * of a compressible type, gets the best encoding Accept-Encoding allows
+ * and a Vary: Accept-Encoding header. Whole files and cached responses
+ * are compressed once per encoding and kept; other bodies are compressed
+ * per response, on the offload pool from http_compress_offload_bytes up.
+ */
+void negotiate_encoding(const HeaderTable& headers, Response& resp);
+
+}  // namespace detail
+
+namespace detail {
+
+/**
+ * A queued response. Entries are reused, so head keeps its capacity.
+ */
+struct Outgoing {
+    std::string head;
+    Response resp;
+    bool head_only = false;   // answers a HEAD, so the body is not sent
+};
+
+}  // namespace detail
+
+/**
+ * Formats an HTTP response for sending over the wire as one string.
+ * The server does not use this; it writes the head and body separately.
+ */
+std::string format_response(const Response& resp, bool keep_alive = false);
+
+/**
+ * A persistent client connection.
+ *
+ * The llhttp parser and the read buffer live as long as the connection,
+ * so bytes read past the end of one request are parsed as the next
+ * pipelined request without another read. Responses are queued and
+ * written together when the connection next has to wait on the socket,
+ * so a pipelined batch is answered with one write. Each response is
+ * gathered from its small head buffer and its own body or file mapping,
+ * so the body is never copied between the handler's return and the
+ * socket.
+ *
+ * The read buffer and the write queue come from a per-thread pool and go
+ * back to it when the connection closes, so a new connection starts with
+ * warm buffers and parsing a request allocates nothing for them.
+ */
+class Connection {
+public:
+    explicit Connection(boost::asio::ip::tcp::socket socket);
+    ~Connection();
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    /**
+     * Reads the next request into req (blocking in goroutine context).
+     * A body longer than http_body_buffer_bytes is not read; req streams
+     * it from here instead. Returns false once the client closes the
+     * connection, sends a malformed request, sends a head longer than
+     * http_max_header_bytes (queueing a 431) or a body longer than
+     * http_max_body_bytes (queueing a 413), or misses a deadline: the
+     * idle timeout before the request starts, http_header_timeout_ms for
+     * the whole head, or http_body_timeout_ms for each read of the body.
+     */
+    bool next(Request& req);
+
+    /**
+     * Returns the next piece of the current request's streamed body, at
+     * most a read buffer's worth, or "" once it has all been read. Reading
+     * only as the handler asks leaves the rest in the socket, so a slow
+     * handler holds back the client instead of growing memory.
+     */
+    std::string read_body();
+
+    /**
+     * True once all of the current request's body has been read.
+     */
+    bool body_complete() const;
+
+    /**
+     * True if the client lets the connection stay open after the request
+     * last returned by next(), per its HTTP version and Connection header.
+     * Only meaningful once body_complete().
+     */
+    bool keep_alive() const;
+
+    /**
+     * Answers the current request's conditional and Range headers for a
+     * file response. The handler has the request itself by then, but the
+     * connection still has its method and headers.
+     */
+    void negotiate_file(Response& resp) const;
+
+    /**
+     * Compresses resp as the current request's Accept-Encoding allows
+     * (see detail::negotiate_encoding).
+     */
+    void negotiate_encoding(Response& resp) const;
+
+    /**
+     * Queues a response for the next flush, taking ownership of its body.
+     * A response to HEAD is sent without its body, but with the
+     * Content-Length a GET would get.
+     */
+    void send(Response resp, bool keep_alive);
+
+    /**
+     * Writes the queued responses. Returns false on a write error or if
+     * the write takes longer than http_write_timeout_ms.
+     */
+    bool flush();
+
+    /**
+     * Queues the head of a streamed response for the current request. The
+     * Connection header is decided now: the connection stays open only if
+     * the request body has been read and the client uses HTTP/1.1 framing.
+     * Does nothing if a stream has already begun.
+     */
+    void begin_stream(int status, std::string_view content_type);
+
+    /**
+     * Appends data to the streamed body, sending it once enough has
+     * built up. Returns false if the stream is not open.
+     */
+    bool write_chunk(std::string_view data);
+
+    /**
+     * Sends the queued head and any buffered body bytes.
+     */
+    bool flush_stream();
+
+    /**
+     * Ends the streamed body. Returns true if the connection may serve
+     * another request.
+     */
+    bool finish_stream();
+
+    /**
+     * True if the handler began a streamed response for the current request.
+     */
+    bool streaming() const;
+
+private:
+    static constexpr std::size_t READ_SIZE = 8192;
+    static constexpr std::size_t STREAM_COPY_BYTES = 4096;    // smaller writes are coalesced
+    static constexpr std::size_t STREAM_FLUSH_BYTES = 16 * 1024;
+
+    bool parse_some();
+    bool read_some();
+    void start_request();
+    std::size_t head_size() const;
+    bool keep_head(std::size_t& keep);
+    void set_deadline(std::chrono::steady_clock::time_point deadline);
+    void expire_after(int timeout_ms);
+    void arm_timer();
+    std::uint64_t body_length() const;
+    bool body_too_large() const;
+    void gather_queued();
+    bool write_gathered();
+    bool write_stream(std::string_view data, bool last);
+
+    boost::asio::ip::tcp::socket socket_;
+    boost::asio::steady_timer timer_;
+    std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+    std::chrono::steady_clock::time_point head_deadline_;
+    bool timer_armed_ = false;
+    bool request_started_ = false;   // a byte of the current request has arrived
+    bool head_request_ = false;      // the current request is a HEAD
+    llhttp_t parser_;
+    HttpParserContext ctx_;
+    std::vector<char> buffer_;
+    std::size_t begin_ = 0;   // unparsed bytes are buffer_[begin_, end_)
+    std::size_t end_ = 0;
+    bool body_failed_ = false;   // the streamed body broke off or grew too large
+
+    std::vector<detail::Outgoing> out_;
+    std::size_t out_count_ = 0;
+    std::vector<boost::asio::const_buffer> gather_;
+
+    enum class Stream { None, Open, Ended, Failed };
+
+    Stream stream_ = Stream::None;
+    bool stream_chunked_ = false;
+    bool stream_keep_alive_ = false;
+    std::string stream_pending_;   // body bytes not yet sent
+    char chunk_size_[24];          // hex size line of the chunk being sent
+    std::shared_ptr<bool> alive_ = std::make_shared<bool>(true);
+};
+
+/**
+ * Serves requests on a connection until the client closes it or asks
+ * for it to be closed. Template must stay in header.
  */
 template<typename Handler>
 void handle_connection(boost::asio::ip::tcp::socket socket, Handler handler) {
     try {
-        Request req = read_request(socket);
-        Response resp = handler(req);
+        Connection conn(std::move(socket));
+        Request req;
 
-        std::string response_str = format_response(resp);
-        boost::system::error_code ec;
-        boost::asio::write(socket, boost::asio::buffer(response_str), ec);
+        while (conn.next(req)) {
+            Response resp = handler(std::move(req));
+
+            // The handler wrote its response through a Writer
+            if (conn.streaming()) {
+                if (!conn.finish_stream()) {
+                    break;
+                }
+
+                continue;
+            }
+
+            // A body the handler left unread closes the connection
+            bool keep_alive = conn.body_complete() && conn.keep_alive();
+
+            if (resp.file) {
+                conn.negotiate_file(resp);
+            }
+
+            conn.negotiate_encoding(resp);
+            conn.send(std::move(resp), keep_alive);
+
+            if (!keep_alive) {
+                break;
+            }
+        }
+
+        conn.flush();
     } catch (const std::exception& e) {
         // Connection closed or error
     }
 }
 
+namespace detail {
+
 /**
- * Main serve function - simple single-handler version.
- * Template must stay in header.
- * Runs accept loop in current fiber, spawns handler fibers.
+ * Opens, binds and listens on the given port. With reuse_port set,
+ * SO_REUSEPORT lets one acceptor per thread share the port while the
+ * kernel spreads incoming connections across them.
+ * Returns an error message, or "" on success.
  */
-template<typename Handler>
-void serve(int port, Handler handler) {
-    boost::asio::ip::tcp::acceptor acceptor(bishop::rt::io_context());
+std::string open_acceptor(boost::asio::ip::tcp::acceptor& acceptor, int port, bool reuse_port);
 
-    try {
-        acceptor.open(boost::asio::ip::tcp::v4());
-        acceptor.set_option(boost::asio::socket_base::reuse_address(true));
-        acceptor.bind({boost::asio::ip::tcp::v4(), static_cast<boost::asio::ip::port_type>(port)});
-        acceptor.listen();
-    } catch (const boost::system::system_error& e) {
-        std::cerr << "Error: Failed to bind to port " << port << ": " << e.what() << std::endl;
-        return;
-    }
+/**
+ * One of the http_max_connections connection slots, held for the life of
+ * a connection. Taking one suspends the accept loop until a slot is free,
+ * so a full server stops accepting instead of piling up fibers, and new
+ * clients wait in the kernel's listen backlog. With no limit set, taking
+ * a slot does nothing.
+ */
+class ConnectionSlot {
+public:
+    ConnectionSlot();
+    ~ConnectionSlot();
 
-    std::cout << "HTTP server listening on port " << port << std::endl;
+    ConnectionSlot(ConnectionSlot&& other) noexcept : held_(std::exchange(other.held_, false)) {}
+    ConnectionSlot(const ConnectionSlot&) = delete;
+    ConnectionSlot& operator=(const ConnectionSlot&) = delete;
+    ConnectionSlot& operator=(ConnectionSlot&&) = delete;
 
+private:
+    bool held_ = false;
+};
+
+/**
+ * Accepts connections forever, handling each one on its own fiber. The
+ * calling fiber must be pinned to the acceptor's thread. Connection fibers
+ * are pinned there too, since their sockets and deadline timers belong
+ * to its io_context. Template must stay in header.
+ */
+template<typename Handler>
+void accept_loop(boost::asio::ip::tcp::acceptor& acceptor, Handler handler) {
     while (true) {
+        ConnectionSlot slot;
         boost::system::error_code ec;
         boost::asio::ip::tcp::socket socket(bishop::rt::io_context());
 
@@ -163,19 +685,276 @@ void serve(int port, Handler handler) {
         acceptor.async_accept(socket, boost::fibers::asio::yield[ec]);
 
         if (!ec) {
-            // Spawn handler as go routine (fiber)
-            boost::fibers::fiber([socket = std::move(socket), handler]() mutable {
+            bishop::rt::spawn_pinned([socket = std::move(socket), handler, slot = std::move(slot)]() mutable {
                 handle_connection(std::move(socket), handler);
-            }).detach();
+            });
         }
     }
 }
 
+/**
+ * Serves the port with one acceptor, or in shared-nothing mode with one
+ * SO_REUSEPORT acceptor per dedicated listener thread. Each listener
+ * thread has its own io_context and scheduler, so nothing is shared on
+ * the request path. Prints an error and returns if the port cannot be
+ * bound. Template must stay in header.
+ */
+template<typename Handler>
+void listen_and_serve(int port, Handler handler) {
+    int listeners = bishop::rt::listener_threads();
+
+    if (listeners <= 1) {
+        bishop::rt::PinnedFiber pin;
+        boost::asio::ip::tcp::acceptor acceptor(bishop::rt::io_context());
+        std::string error = open_acceptor(acceptor, port, false);
+
+        if (!error.empty()) {
+            std::cerr << "Error: " << error << std::endl;
+            return;
+        }
+
+        std::cout << "HTTP server listening on port " << port << std::endl;
+        accept_loop(acceptor, handler);
+        return;
+    }
+
+    // Every listener binds before any accepts; the first error is reported
+    auto error = std::make_shared<std::string>();
+    auto error_mutex = std::make_shared<std::mutex>();
+    auto announced = std::make_shared<std::once_flag>();
+
+    bool served = bishop::rt::run_prepared_per_core(listeners, [=]() -> std::function<void()> {
+        auto acceptor = std::make_shared<boost::asio::ip::tcp::acceptor>(bishop::rt::io_context());
+        std::string failure = open_acceptor(*acceptor, port, true);
+
+        if (!failure.empty()) {
+            std::lock_guard<std::mutex> lock(*error_mutex);
+
+            if (error->empty()) {
+                *error = std::move(failure);
+            }
+
+            return {};
+        }
+
+        return [acceptor, handler, port, listeners, announced]() {
+            std::call_once(*announced, [port, listeners]() {
+                std::cout << "HTTP server listening on port " << port
+                          << " (" << listeners << " listeners)" << std::endl;
+            });
+
+            accept_loop(*acceptor, handler);
+        };
+    });
+
+    if (!served) {
+        std::cerr << "Error: " << *error << std::endl;
+    }
+}
+
+}  // namespace detail
+
+/**
+ * Main serve function - simple single-handler version.
+ * Template must stay in header.
+ * Runs accept loop in current fiber, spawns handler fibers.
+ */
+template<typename Handler>
+void serve(int port, Handler handler) {
+    detail::listen_and_serve(port, handler);
+}
+
+/**
+ * Radix-tree request router with one tree per method.
+ *
+ * Static path bytes are stored in compressed prefix nodes. A `:name`
+ * segment captures up to the next '/', and a trailing `*` or `*name`
+ * captures the rest of the path. Static routes take precedence over
+ * params, and params over wildcards, so a lookup walks the path once
+ * and only backtracks where a more specific branch dead-ends. The query
+ * string is not part of the match.
+ */
+class Router {
+public:
+    using Handler = std::function<Response(Request)>;
+
+    /**
+     * Adds a route. The first handler added for a pattern wins.
+     * Throws std::invalid_argument if the pattern gives a parameter a
+     * different name than an existing route at the same position.
+     */
+    void add(std::string_view method, std::string_view pattern, Handler handler);
+
+    /**
+     * Returns the handler for the request, recording captured params on
+     * it, or nullptr if no route matches.
+     */
+    const Handler* match(Request& req) const;
+
+private:
+    struct Node {
+        std::string prefix;       // static bytes matched by this node
+        std::string name;         // capture name for param and wildcard nodes
+        std::string indices;      // first byte of each static child
+        std::vector<std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> param;
+        std::unique_ptr<Node> wildcard;
+        int handler = -1;         // index into handlers_
+    };
+
+    void insert(Node& node, std::string_view pattern, int handler);
+    const Node* find(const Node& node, std::string_view path, std::size_t offset,
+                     Request& req) const;
+
+    std::vector<std::pair<std::string, std::unique_ptr<Node>>> trees_;
+    std::vector<Handler> handlers_;
+};
+
+namespace detail {
+
+/**
+ * A response held by ResponseCache, serialized up to its Connection
+ * header. Responses served from the cache share it, so eviction never
+ * frees bytes that are still being written. Compressed forms are kept
+ * with the entry and go when it does.
+ */
+struct CachedResponse {
+    std::string head;   // status line and headers, without Connection
+    std::string body;
+    std::string content_type;
+    std::string headers;   // the handler's extra header lines, for re-serializing
+    std::chrono::steady_clock::time_point expires;
+    mutable EncodedForms<CachedResponse> encoded;
+};
+
+/**
+ * Sharded LRU cache of serialized GET responses, behind App::cache().
+ *
+ * Entries are keyed by method, path with query, and the values of the
+ * vary headers. Each shard has its own lock, LRU list, counters and
+ * share of max_bytes, so threads serving different keys rarely contend.
+ * An expired entry is dropped when it is next looked up, or evicted
+ * with the least recently used ones when its shard is full.
+ */
+class ResponseCache {
+public:
+    struct Rule {
+        std::string prefix;
+        int ttl_ms = 0;
+    };
+
+    std::vector<Rule> rules;          // cached path prefixes
+    std::vector<std::string> vary;    // request headers that are part of the key
+    std::size_t max_bytes = 64 << 20;
+
+    /**
+     * Returns the TTL of the longest rule prefixing path, or 0 if no rule
+     * covers it. A rule with a TTL of 0 excludes its prefix.
+     */
+    int ttl_for(std::string_view path) const;
+
+    /**
+     * True if req carries an Authorization or Cookie header that is not
+     * part of the key. Its response may be meant for that client alone,
+     * so it is neither looked up nor stored.
+     */
+    bool bypasses(const Request& req) const;
+
+    /**
+     * Writes the key for req into key.
+     */
+    void make_key(const Request& req, std::string& key) const;
+
+    /**
+     * Returns the live entry for key, or nullptr, and counts a hit or miss.
+     */
+    std::shared_ptr<const CachedResponse> find(std::string_view key);
+
+    /**
+     * Adds or replaces the entry for key, evicting least recently used
+     * entries to stay within the shard's share of max_bytes. An entry
+     * larger than that share is not cached.
+     */
+    void insert(std::string_view key, std::shared_ptr<const CachedResponse> response);
+
+    std::uint64_t hits();
+    std::uint64_t misses();
+
+private:
+    static constexpr std::size_t SHARDS = 16;
+
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const CachedResponse> response;
+        std::size_t bytes = 0;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;   // most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;   // views of Entry::key
+        std::size_t bytes = 0;
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+    };
+
+    Shard& shard(std::string_view key);
+
+    std::array<Shard, SHARDS> shards_;
+};
+
+}  // namespace detail
+
+/**
+ * The rest of a middleware chain, handed to each middleware. Step is the
+ * next middleware or the router, and is a concrete type rather than a
+ * std::function, so run() is a direct call.
+ *
+ * Bishop functions taking an http.Next are emitted as templates over
+ * Step, with the request taken by reference. For an App the compiler
+ * folds into a static dispatcher, Step is a generated lambda and the
+ * whole chain inlines; otherwise it is App's runtime chain. Either way
+ * the route's handler gets its own copy of the request, as a Bishop
+ * parameter, and req is unchanged when run() returns.
+ */
+template<typename Step>
+struct Next {
+    Step step;
+
+    /**
+     * Runs the remaining middleware and the route's handler.
+     */
+    Response run(Request& req) const {
+        return step(req);
+    }
+};
+
+struct App;
+
+namespace detail {
+
+/**
+ * Next step of a runtime App's middleware chain: the middleware at
+ * index, or the cache and router once index passes the last one.
+ */
+struct AppChain {
+    App* app;
+    std::size_t index;
+
+    Response operator()(Request& req) const;
+};
+
+}  // namespace detail
+
 /**
  * App struct for routing-based HTTP server.
  */
 struct App {
-    std::vector<std::tuple<std::string, std::string, std::function<Response(Request)>>> routes;
+    using Middleware = Response (*)(Request&, Next<detail::AppChain>);
+
+    Router router;
+    std::unique_ptr<detail::ResponseCache> response_cache;   // set by the first cache() call
+    std::vector<Middleware> middleware;
 
     /**
      * Register a GET route handler.
@@ -188,9 +967,48 @@ struct App {
     void post(const std::string& path, std::function<Response(Request)> handler);
 
     /**
-     * Route a request to the appropriate handler.
+     * Adds a middleware around every route, inside those added before it.
+     * Bishop middleware are templates, instantiated here for AppChain.
+     */
+    void use(Middleware mw);
+
+    /**
+     * Caches 200 responses to GET requests whose path starts with prefix
+     * for ttl_ms. A hit is answered with the stored bytes, without
+     * routing, calling the handler or formatting the response. File and
+     * streamed responses are not cached.
+     */
+    void cache(const std::string& prefix, int ttl_ms);
+
+    /**
+     * Makes the named request header part of the cache key, for routes
+     * whose response depends on it.
+     */
+    void cache_vary(const std::string& header);
+
+    /**
+     * Sets the most bytes of responses the cache holds (64 MiB by default).
+     */
+    void cache_limit(int max_bytes);
+
+    /**
+     * Requests answered from the cache, and cacheable requests that were
+     * not, capped at INT_MAX.
+     */
+    int cache_hits();
+    int cache_misses();
+
+    /**
+     * Runs a request through the middleware, then dispatch().
      */
-    Response route(const Request& req);
+    Response route(Request& req);
+
+    /**
+     * Route a request to the appropriate handler, filling in its params,
+     * and move it into the handler. Requests covered by cache() are
+     * answered from the cache when they can be.
+     */
+    Response dispatch(Request& req);
 
     /**
      * Start listening on the given port.
@@ -198,4 +1016,74 @@ struct App {
     void listen(int port);
 };
 
+namespace detail {
+
+/**
+ * Keep-alive connections of a Client, pooled per thread and host:port.
+ * Defined in client.cpp.
+ */
+struct ClientPool;
+
+std::shared_ptr<ClientPool> new_client_pool();
+
+}  // namespace detail
+
+/**
+ * HTTP/1.1 client with per-host keep-alive connection pools.
+ *
+ * A request runs on the calling fiber and suspends it for connecting,
+ * writing and reading, so fibers fanning out to upstreams wait in
+ * parallel instead of blocking the thread. Each in-flight request has a
+ * connection to itself; finished ones go back to the calling thread's
+ * pool, so the per-host limits apply per thread. Copies share the pools,
+ * so a Client can be handed to other fibers.
+ *
+ * Only http:// URLs are supported.
+ */
+struct Client {
+    int timeout_ms = 30000;              // whole request, from connect to last byte; 0 = never
+    int max_connections_per_host = 0;    // requests past this wait for a connection; 0 = no limit
+    int max_idle_per_host = 32;          // idle keep-alive connections kept per host
+    int idle_timeout_ms = 30000;         // idle connections unused this long are closed; 0 = never
+    int max_body_bytes = 64 << 20;       // longer response bodies, before or after decoding, fail; 0 = no limit
+    std::string headers;                 // sent with every request, each line ending in "\r\n"
+    std::shared_ptr<detail::ClientPool> pool = detail::new_client_pool();
+
+    /**
+     * Sends the header with every later request, replacing any value set
+     * for the same name before.
+     */
+    void set_header(const std::string& name, const std::string& value);
+
+    /**
+     * Sends a GET request and returns the response, or an error if the
+     * URL is invalid, the host cannot be reached or the request timed out.
+     */
+    bishop::rt::Result<Response> get(const std::string& url);
+
+    /**
+     * Sends a POST request with the given body.
+     */
+    bishop::rt::Result<Response> post(const std::string& url, const std::string& content_type,
+                                      const std::string& body);
+
+    /**
+     * Sends a request with any method. An empty content_type sends no
+     * Content-Type header.
+     */
+    bishop::rt::Result<Response> request(const std::string& method, const std::string& url,
+                                         const std::string& content_type, const std::string& body);
+};
+
+/**
+ * GET through a process-wide Client with default settings.
+ */
+bishop::rt::Result<Response> get(const std::string& url);
+
+/**
+ * POST through a process-wide Client with default settings.
+ */
+bishop::rt::Result<Response> post(const std::string& url, const std::string& content_type,
+                                  const std::string& body);
+
 }  // namespace http
@@ -9,32 +9,151 @@
 #pragma once
 
 #include <boost/fiber/all.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
 namespace bishop::rt {
 
+namespace detail {
+
+/**
+ * A fiber parked in a select statement. Any watched channel wakes it.
+ */
+class SelectWaiter {
+public:
+    /**
+     * Marks the waiter ready and wakes its fiber.
+     */
+    void wake() {
+        {
+            std::lock_guard<boost::fibers::mutex> lock(mutex_);
+            ready_ = true;
+        }
+
+        cv_.notify_one();
+    }
+
+    /**
+     * Parks the calling fiber until wake() is called.
+     */
+    void wait() {
+        std::unique_lock<boost::fibers::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return ready_; });
+        ready_ = false;
+    }
+
+private:
+    boost::fibers::mutex mutex_;
+    boost::fibers::condition_variable cv_;
+    bool ready_ = false;
+};
+
+/**
+ * Type-erased part of a channel that select waiters register with.
+ */
+class Selectable {
+public:
+    void watch(SelectWaiter* waiter) {
+        std::lock_guard<boost::fibers::mutex> lock(watchers_mutex_);
+        watchers_.push_back(waiter);
+        watcher_count_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    void unwatch(SelectWaiter* waiter) {
+        std::lock_guard<boost::fibers::mutex> lock(watchers_mutex_);
+        watchers_.erase(std::find(watchers_.begin(), watchers_.end(), waiter));
+        watcher_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+protected:
+    /**
+     * Wakes every select waiting on this channel. Called after a value has
+     * been pushed; the fence pairs with watch() so a select that registered
+     * before its try_recv() either sees the value or gets woken.
+     */
+    void notify_watchers() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (watcher_count_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+
+        std::lock_guard<boost::fibers::mutex> lock(watchers_mutex_);
+
+        for (SelectWaiter* waiter : watchers_) {
+            waiter->wake();
+        }
+    }
+
+private:
+    boost::fibers::mutex watchers_mutex_;
+    std::vector<SelectWaiter*> watchers_;
+    std::atomic<int> watcher_count_{0};
+};
+
+}  // namespace detail
+
 /**
  * Typed channel for communication between fibers.
- * Wraps boost::fibers::buffered_channel with send/recv API.
+ *
+ * A channel with capacity n buffers up to n values; send() blocks only
+ * when the buffer is full. Capacity 0 makes an unbuffered rendezvous
+ * channel: send() blocks until a receiver has taken the value.
+ * Safe to share between fibers on different scheduler threads.
  */
 template<typename T>
-class Channel {
+class Channel : public detail::Selectable {
 public:
-    Channel() : ch_(2) {}  // capacity must be power of 2, min 2 for boost::fibers
+    static constexpr int DEFAULT_CAPACITY = 1;
+
+    Channel() : Channel(DEFAULT_CAPACITY) {}
+
+    explicit Channel(int capacity)
+        : unbuffered_(capacity == 0),
+          buffer_(capacity > 0 ? static_cast<std::size_t>(capacity) : 1) {
+        if (capacity < 0) {
+            throw std::invalid_argument("channel capacity must not be negative");
+        }
+    }
 
     /**
-     * Send a value through the channel. Blocks until space available.
+     * Send a value through the channel. Blocks until space available,
+     * and for unbuffered channels until a receiver has taken the value.
+     * Sending on a closed channel drops the value.
      */
     void send(const T& value) {
-        ch_.push(value);
+        put(value);
+    }
+
+    /**
+     * Send a value by moving it into the channel; no copy is made.
+     */
+    void send(T&& value) {
+        put(std::move(value));
     }
 
     /**
      * Receive a value from the channel. Blocks until available.
+     * Returns a default value once the channel is closed and drained.
      */
     T recv() {
-        T value;
-        ch_.pop(value);
+        std::unique_lock<boost::fibers::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this]() { return closed_ || count_ > 0; });
+
+        if (count_ == 0) {
+            return T{};
+        }
+
+        T value = take();
+        lock.unlock();
+        wake_senders();
         return value;
     }
 
@@ -42,23 +161,132 @@ public:
      * Try to receive a value without blocking. Returns pair<bool, T>.
      */
     std::pair<bool, T> try_recv() {
-        T value;
-        auto status = ch_.try_pop(value);
-        if (status == boost::fibers::channel_op_status::success) {
-            return {true, value};
+        std::unique_lock<boost::fibers::mutex> lock(mutex_);
+
+        if (count_ == 0) {
+            return {false, T{}};
         }
-        return {false, T{}};
+
+        std::pair<bool, T> result{true, take()};
+        lock.unlock();
+        wake_senders();
+        return result;
     }
 
     /**
-     * Close the channel.
+     * Close the channel, waking every blocked sender and receiver.
      */
     void close() {
-        ch_.close();
+        {
+            std::lock_guard<boost::fibers::mutex> lock(mutex_);
+            closed_ = true;
+        }
+
+        not_full_.notify_all();
+        not_empty_.notify_all();
+        notify_watchers();
+    }
+
+private:
+    /**
+     * Shared body of both send() overloads. The value is constructed
+     * directly in its buffer slot.
+     */
+    template<typename U>
+    void put(U&& value) {
+        std::unique_lock<boost::fibers::mutex> lock(mutex_);
+        not_full_.wait(lock, [this]() { return closed_ || count_ < buffer_.size(); });
+
+        if (closed_) {
+            return;
+        }
+
+        buffer_[(head_ + count_) % buffer_.size()].emplace(std::forward<U>(value));
+        count_++;
+        std::uint64_t ticket = ++sent_;
+
+        lock.unlock();
+        not_empty_.notify_one();
+        notify_watchers();
+
+        if (unbuffered_) {
+            lock.lock();
+            not_full_.wait(lock, [this, ticket]() { return closed_ || received_ >= ticket; });
+        }
+    }
+
+    /**
+     * Moves the oldest buffered value out and empties its slot.
+     * Caller holds the lock.
+     */
+    T take() {
+        std::optional<T>& slot = buffer_[head_];
+        T value = std::move(*slot);
+        slot.reset();
+        head_ = (head_ + 1) % buffer_.size();
+        count_--;
+        received_++;
+        return value;
+    }
+
+    /**
+     * Wakes senders after a value was taken. Rendezvous senders wait on
+     * the same condition for their own value, so all of them are woken.
+     */
+    void wake_senders() {
+        if (unbuffered_) {
+            not_full_.notify_all();
+        } else {
+            not_full_.notify_one();
+        }
+    }
+
+    boost::fibers::mutex mutex_;
+    boost::fibers::condition_variable not_empty_;
+    boost::fibers::condition_variable not_full_;
+    bool unbuffered_;
+    bool closed_ = false;
+    std::vector<std::optional<T>> buffer_;   // ring buffer; one handoff slot when unbuffered
+    std::size_t head_ = 0;
+    std::size_t count_ = 0;
+    std::uint64_t sent_ = 0;
+    std::uint64_t received_ = 0;
+};
+
+/**
+ * Parks a select statement's fiber until one of its channels has data.
+ * Registers with every watched channel and unregisters on destruction.
+ */
+class Select {
+public:
+    Select() = default;
+    Select(const Select&) = delete;
+    Select& operator=(const Select&) = delete;
+
+    ~Select() {
+        for (detail::Selectable* channel : channels_) {
+            channel->unwatch(&waiter_);
+        }
+    }
+
+    /**
+     * Registers this select with a channel. Must precede the first try_recv().
+     */
+    void watch(detail::Selectable& channel) {
+        channel.watch(&waiter_);
+        channels_.push_back(&channel);
+    }
+
+    /**
+     * Parks until a watched channel receives a value or is closed.
+     */
+    void wait() {
+        waiter_.wait();
     }
 
 private:
-    boost::fibers::buffered_channel<T> ch_;
+    detail::SelectWaiter waiter_;
+    std::vector<detail::Selectable*> channels_;
 };
 
 }  // namespace bishop::rt
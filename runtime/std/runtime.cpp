@@ -11,38 +11,407 @@
 #include <boost/asio.hpp>
 #include <boost/asio/spawn.hpp>
 
+#include <bishop/std.hpp>
+#include <bishop/fiber_asio/pooled_stack.hpp>
 #include <bishop/fiber_asio/round_robin.hpp>
+#include <bishop/fiber_asio/timer_wheel.hpp>
+#include <bishop/fiber_asio/work_stealing.hpp>
 
 #include <functional>
 #include <memory>
 #include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
 
 namespace bishop::rt {
 
-// Global io_context - initialized by run()
-static std::shared_ptr<boost::asio::io_context> g_io_ctx;
+// Per-thread io_context - each scheduler thread drives its own
+static thread_local std::shared_ptr<boost::asio::io_context> t_io_ctx;
+
+// Per-thread timer wheel, driven by that thread's io_context
+static thread_local std::unique_ptr<boost::fibers::asio::timer_wheel> t_timers;
+
+// HTTP listener threads, resolved once by run()
+static int g_listeners = 1;
+
+// Blocking-offload pool size, resolved once by run()
+static int g_offload_threads = 4;
+
+// HTTP keep-alive idle timeout, set once by run()
+static int g_http_idle_timeout_ms = 5000;
+
+// HTTP request body limits, set once by run()
+static std::size_t g_http_body_buffer_bytes = 1 << 20;
+static std::size_t g_http_max_body_bytes = 0;
+
+// HTTP connection limits and deadlines, set once by run()
+static int g_http_max_connections = 0;
+static int g_http_header_timeout_ms = 10000;
+static int g_http_body_timeout_ms = 30000;
+static int g_http_write_timeout_ms = 30000;
+static std::size_t g_http_max_header_bytes = 64 * 1024;
+
+// HTTP response compression thresholds, set once by run()
+static std::size_t g_http_compress_min_bytes = 0;
+static std::size_t g_http_compress_offload_bytes = 0;
+
+/**
+ * Resolves a thread count from config, letting the named environment
+ * variable override it. Zero (or a negative count) means one per CPU core.
+ */
+static int resolve_threads(int configured, const char* env_name) {
+    int threads = configured;
+
+    if (const char* env = std::getenv(env_name)) {
+        char* end = nullptr;
+        long value = std::strtol(env, &end, 10);
+
+        if (end != env && *end == '\0') {
+            threads = static_cast<int>(value);
+        }
+    }
+
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    return threads;
+}
+
+/**
+ * Starts a fiber on a pooled stack.
+ */
+template<typename Fn>
+static boost::fibers::fiber make_fiber(Fn&& fn) {
+    return boost::fibers::fiber(std::allocator_arg, boost::fibers::asio::pooled_stack(),
+                                std::forward<Fn>(fn));
+}
+
+/**
+ * Applies the fiber stack settings. Runs before the first fiber starts.
+ */
+static void configure_stacks(const RuntimeConfig& config) {
+    boost::fibers::asio::pooled_stack::settings stacks;
+
+    if (config.stack_size > 0) {
+        stacks.size = static_cast<std::size_t>(config.stack_size);
+    }
+
+    stacks.pool_limit = static_cast<std::size_t>(std::max(0, config.stack_pool));
+    stacks.guard_page = config.stack_guard;
+    boost::fibers::asio::pooled_stack::configure(stacks);
+}
+
+/**
+ * Pins the calling thread to a CPU core, wrapping around the core count.
+ */
+static void pin_to_core(int core) {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<unsigned>(core) % cores, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/**
+ * Installs the work-stealing scheduler on the calling thread.
+ */
+static void init_worker(const std::shared_ptr<boost::fibers::asio::work_stealing::pool>& pool, std::size_t id) {
+    t_io_ctx = std::make_shared<boost::asio::io_context>();
+    t_timers = std::make_unique<boost::fibers::asio::timer_wheel>(t_io_ctx);
+    boost::fibers::use_scheduling_algorithm<
+        boost::fibers::asio::work_stealing>(pool, id, t_io_ctx);
+}
 
 void init_runtime() {
-    g_io_ctx = std::make_shared<boost::asio::io_context>();
+    t_io_ctx = std::make_shared<boost::asio::io_context>();
+    t_timers = std::make_unique<boost::fibers::asio::timer_wheel>(t_io_ctx);
     boost::fibers::use_scheduling_algorithm<
-        boost::fibers::asio::round_robin>(g_io_ctx);
+        boost::fibers::asio::round_robin>(t_io_ctx);
+}
+
+void run(Task main_fn) {
+    run(std::move(main_fn), RuntimeConfig{});
+}
+
+void configure(const RuntimeConfig& config) {
+    g_listeners = resolve_threads(config.listeners, "BISHOP_LISTENERS");
+    g_offload_threads = resolve_threads(config.offload_threads, "BISHOP_OFFLOAD_THREADS");
+    g_http_idle_timeout_ms = std::max(0, config.http_idle_timeout_ms);
+    g_http_body_buffer_bytes = static_cast<std::size_t>(std::max(0, config.http_body_buffer_bytes));
+    g_http_max_body_bytes = static_cast<std::size_t>(std::max(0, config.http_max_body_bytes));
+    g_http_max_connections = std::max(0, config.http_max_connections);
+    g_http_header_timeout_ms = std::max(0, config.http_header_timeout_ms);
+    g_http_body_timeout_ms = std::max(0, config.http_body_timeout_ms);
+    g_http_write_timeout_ms = std::max(0, config.http_write_timeout_ms);
+    g_http_max_header_bytes = static_cast<std::size_t>(std::max(1024, config.http_max_header_bytes));
+    g_http_compress_min_bytes = static_cast<std::size_t>(std::max(0, config.http_compress_min_bytes));
+    g_http_compress_offload_bytes = static_cast<std::size_t>(std::max(0, config.http_compress_offload_bytes));
+    configure_stacks(config);
+}
+
+void run(Task main_fn, const RuntimeConfig& config) {
+    int workers = resolve_threads(config.workers, "BISHOP_WORKERS");
+    configure(config);
+
+    if (workers == 1) {
+        init_runtime();
+
+        // Drive the io_context on the main context; the scheduler yields
+        // to ready fibers from inside it and stops it when main returns.
+        auto io_ctx = t_io_ctx;
+        make_fiber([main_fn = std::move(main_fn), io_ctx]() mutable {
+            main_fn();
+            io_ctx->stop();
+        }).detach();
+        io_ctx->run();
+        return;
+    }
+
+    auto pool = std::make_shared<boost::fibers::asio::work_stealing::pool>(workers);
+
+    // Worker threads live for the rest of the process. Their main context
+    // parks forever so the dispatcher keeps running stolen fibers.
+    for (int id = 1; id < workers; id++) {
+        std::thread([pool, id]() {
+            init_worker(pool, static_cast<std::size_t>(id));
+            boost::fibers::promise<void> park;
+            park.get_future().wait();
+        }).detach();
+    }
+
+    init_worker(pool, 0);
+    make_fiber(std::move(main_fn)).join();
+
+    // Fibers still parked on other workers can never be joined
+    exit(0);
+}
+
+int listener_threads() {
+    return g_listeners;
+}
+
+int http_idle_timeout_ms() {
+    return g_http_idle_timeout_ms;
+}
+
+std::size_t http_body_buffer_bytes() {
+    return g_http_body_buffer_bytes;
+}
+
+std::size_t http_max_body_bytes() {
+    return g_http_max_body_bytes;
+}
+
+int http_max_connections() {
+    return g_http_max_connections;
+}
+
+int http_header_timeout_ms() {
+    return g_http_header_timeout_ms;
+}
+
+int http_body_timeout_ms() {
+    return g_http_body_timeout_ms;
+}
+
+int http_write_timeout_ms() {
+    return g_http_write_timeout_ms;
+}
+
+std::size_t http_max_header_bytes() {
+    return g_http_max_header_bytes;
+}
+
+std::size_t http_compress_min_bytes() {
+    return g_http_compress_min_bytes;
+}
+
+std::size_t http_compress_offload_bytes() {
+    return g_http_compress_offload_bytes;
+}
+
+bool run_prepared_per_core(int threads, std::function<std::function<void()>()> prepare) {
+    struct Progress {
+        boost::fibers::mutex mutex;
+        boost::fibers::condition_variable changed;
+        int prepared = 0;
+        int failed = 0;
+        int running = 0;
+    };
+
+    auto progress = std::make_shared<Progress>();
+    progress->running = threads;
+
+    for (int core = 0; core < threads; core++) {
+        std::thread([prepare, progress, core, threads]() {
+            pin_to_core(core);
+            init_runtime();
+
+            std::function<void()> loop = prepare();
+            bool start = false;
+
+            // Nothing is started until every thread has prepared, so a
+            // failure leaves no fibers behind on the others
+            {
+                std::unique_lock<boost::fibers::mutex> lock(progress->mutex);
+                progress->prepared++;
+                progress->failed += loop ? 0 : 1;
+                progress->changed.notify_all();
+                progress->changed.wait(lock, [&progress, threads]() { return progress->prepared == threads; });
+                start = progress->failed == 0;
+            }
+
+            if (start) {
+                auto io_ctx = t_io_ctx;
+                make_fiber([loop = std::move(loop), io_ctx]() {
+                    loop();
+                    io_ctx->stop();
+                }).detach();
+                io_ctx->run();
+            }
+
+            {
+                std::unique_lock<boost::fibers::mutex> lock(progress->mutex);
+                progress->running--;
+            }
+
+            progress->changed.notify_all();
+        }).detach();
+    }
+
+    std::unique_lock<boost::fibers::mutex> lock(progress->mutex);
+    progress->changed.wait(lock, [&progress]() { return progress->running == 0; });
+    return progress->failed == 0;
+}
+
+void run_per_core(int threads, std::function<void()> fn) {
+    run_prepared_per_core(threads, [fn = std::move(fn)]() -> std::function<void()> {
+        return fn;
+    });
+}
+
+void run_in_fiber(Task fn) {
+    make_fiber(std::move(fn)).join();
 }
 
-void run(std::function<void()> main_fn) {
-    init_runtime();
-    boost::fibers::fiber(main_fn).join();
+void exit(int code) {
+    std::cout.flush();
+    std::fflush(nullptr);
+    std::_Exit(code);
 }
 
-void run_in_fiber(std::function<void()> fn) {
-    boost::fibers::fiber(fn).join();
+void spawn(Task fn) {
+    make_fiber(std::move(fn)).detach();
 }
 
-void spawn(std::function<void()> fn) {
-    boost::fibers::fiber(fn).detach();
+void spawn_pinned(Task fn) {
+    // launch::dispatch switches to the new fiber right away, so it pins
+    // itself before it is ever in a queue a peer could steal from
+    boost::fibers::fiber(boost::fibers::launch::dispatch, std::allocator_arg, boost::fibers::asio::pooled_stack(),
+                         [fn = std::move(fn)]() mutable {
+        PinnedFiber pin;
+        fn();
+    }).detach();
 }
 
+PinnedFiber::PinnedFiber() : pinned_(boost::fibers::asio::work_stealing::pin()) {}
+
+PinnedFiber::~PinnedFiber() {
+    if (pinned_) {
+        boost::fibers::asio::work_stealing::unpin();
+    }
+}
+
+/**
+ * Fixed-size pool of OS threads for blocking work. Threads start on the
+ * first offload and live for the rest of the process.
+ */
+class OffloadPool {
+public:
+    explicit OffloadPool(int threads) {
+        for (int i = 0; i < threads; i++) {
+            std::thread([this]() { work(); }).detach();
+        }
+    }
+
+    void submit(Task job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+
+        ready_.notify_one();
+    }
+
+private:
+    void work() {
+        while (true) {
+            Task job;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this]() { return !jobs_.empty(); });
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+
+            job();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Task> jobs_;
+};
+
+void offload_task(Task work) {
+    // Leaked on purpose: detached pool threads may outlive static teardown
+    static OffloadPool* pool = new OffloadPool(g_offload_threads);
+
+    boost::fibers::promise<void> done;
+    boost::fibers::future<void> finished = done.get_future();
+
+    pool->submit([&work, &done]() {
+        work();
+        done.set_value();
+    });
+
+    finished.wait();
+}
+
+/**
+ * A fiber parked on the timer wheel until its deadline.
+ */
+struct Sleeper : boost::fibers::asio::timer_wheel::timer {
+    boost::fibers::context* ctx = boost::fibers::context::active();
+};
+
 void sleep_ms(int ms) {
-    boost::this_fiber::sleep_for(std::chrono::milliseconds(ms));
+    if (ms <= 0) {
+        boost::this_fiber::yield();
+        return;
+    }
+
+    if (!t_timers) {
+        boost::this_fiber::sleep_for(std::chrono::milliseconds(ms));
+        return;
+    }
+
+    Sleeper sleeper;
+    sleeper.fire = [](boost::fibers::asio::timer_wheel::timer* t) {
+        boost::fibers::context::active()->schedule(static_cast<Sleeper*>(t)->ctx);
+    };
+
+    t_timers->add(sleeper, std::chrono::milliseconds(ms));
+    sleeper.ctx->suspend();
 }
 
 void yield() {
@@ -50,10 +419,10 @@ void yield() {
 }
 
 boost::asio::io_context& io_context() {
-    if (!g_io_ctx) {
+    if (!t_io_ctx) {
         throw std::runtime_error("Runtime not initialized");
     }
-    return *g_io_ctx;
+    return *t_io_ctx;
 }
 
 }  // namespace bishop::rt
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <iostream>
 #include <string>
 #include <cstdint>
@@ -21,16 +22,147 @@
 #include <thread>
 #include <mutex>
 #include <chrono>
+#include <exception>
+#include <new>
+#include <type_traits>
 
 // Error handling primitives
 #include <bishop/error.hpp>
 
 namespace bishop::rt {
 
+// ============================================================================
+// Task (header-only, no boost dependency)
+// ============================================================================
+
+/**
+ * Move-only callable passed to spawn() and run().
+ *
+ * Callables up to INLINE_SIZE bytes are stored inside the Task itself, so
+ * wrapping a go-spawn closure never touches the heap. The runtime moves
+ * the Task into the new fiber's control block, which lives on the
+ * fiber's stack. Larger callables fall back to a heap allocation.
+ */
+class Task {
+public:
+    static constexpr size_t INLINE_SIZE = 64;
+
+    Task() = default;
+
+    template<typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, Task>>>
+    Task(Fn&& fn) {
+        using F = std::decay_t<Fn>;
+
+        if constexpr (sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<F>) {
+            new (storage_) F(std::forward<Fn>(fn));
+            ops_ = &inline_ops<F>;
+        } else {
+            *reinterpret_cast<F**>(storage_) = new F(std::forward<Fn>(fn));
+            ops_ = &heap_ops<F>;
+        }
+    }
+
+    Task(Task&& other) noexcept : ops_(other.ops_) {
+        if (ops_) {
+            ops_->move(other.storage_, storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            ops_ = other.ops_;
+
+            if (ops_) {
+                ops_->move(other.storage_, storage_);
+                other.ops_ = nullptr;
+            }
+        }
+
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops_->invoke(storage_); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* from, void* to);   // leaves from destroyed
+        void (*destroy)(void* storage);
+    };
+
+    template<typename F>
+    static constexpr Ops inline_ops = {
+        [](void* s) { (*static_cast<F*>(s))(); },
+        [](void* from, void* to) {
+            new (to) F(std::move(*static_cast<F*>(from)));
+            static_cast<F*>(from)->~F();
+        },
+        [](void* s) { static_cast<F*>(s)->~F(); },
+    };
+
+    template<typename F>
+    static constexpr Ops heap_ops = {
+        [](void* s) { (**static_cast<F**>(s))(); },
+        [](void* from, void* to) { *static_cast<F**>(to) = *static_cast<F**>(from); },
+        [](void* s) { delete *static_cast<F**>(s); },
+    };
+
+    void reset() {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+    const Ops* ops_ = nullptr;
+};
+
 // ============================================================================
 // Runtime Functions (implemented in runtime.cpp)
 // ============================================================================
 
+/**
+ * Runtime settings, filled in by generated main() from bishop.toml.
+ * The BISHOP_WORKERS and BISHOP_LISTENERS environment variables override
+ * `workers` and `listeners` at startup.
+ */
+struct RuntimeConfig {
+    int workers = 1;      // scheduler threads; 0 = one per CPU core
+    int listeners = 1;    // SO_REUSEPORT http listener threads; 0 = one per CPU core
+    int stack_size = 0;   // fiber stack size in bytes; 0 = platform default
+    int stack_pool = 256; // free fiber stacks kept per thread for reuse
+    bool stack_guard = true;  // PROT_NONE guard page below each fiber stack
+    int offload_threads = 4;  // blocking-offload pool threads; 0 = one per CPU core
+    int http_idle_timeout_ms = 5000;  // idle keep-alive connections close after this; 0 = never
+    int http_body_buffer_bytes = 1 << 20;  // longer request bodies are streamed, not buffered
+    int http_max_body_bytes = 0;  // longer request bodies get 413; 0 = no limit
+    int http_max_connections = 0;  // accepting pauses at this many open connections; 0 = no limit
+    int http_header_timeout_ms = 10000;  // a request head must arrive within this of its first byte; 0 = never
+    int http_body_timeout_ms = 30000;  // each read of a request body must get data within this; 0 = never
+    int http_write_timeout_ms = 30000;  // each response write must finish within this; 0 = never
+    int http_max_header_bytes = 64 * 1024;  // longer request heads close the connection
+    int http_compress_min_bytes = 0;  // response bodies this large are compressed when accepted; 0 = never
+    int http_compress_offload_bytes = 0;  // bodies this large are compressed on the offload pool; 0 = never
+};
+
+/**
+ * Applies every setting in config but the worker count. Called by run();
+ * test programs, which start the scheduler with init_runtime(), call it
+ * first.
+ */
+void configure(const RuntimeConfig& config);
+
 /**
  * Initialize the fiber-asio scheduler.
  * Called automatically by run(), but can be called manually for tests.
@@ -41,21 +173,197 @@ void init_runtime();
  * Initialize and run the main function in a fiber context.
  * Sets up the fiber-asio scheduler.
  */
-void run(std::function<void()> main_fn);
+void run(Task main_fn);
+
+/**
+ * Initialize and run the main function with the given runtime settings.
+ * With more than one worker, every worker thread gets its own io_context
+ * and fibers are load-balanced across them by work stealing.
+ */
+void run(Task main_fn, const RuntimeConfig& config);
+
+/**
+ * Returns how many listener threads HTTP servers should run.
+ * More than one selects the shared-nothing SO_REUSEPORT mode.
+ */
+int listener_threads();
+
+/**
+ * Returns how long an HTTP connection may wait for its next request, in
+ * milliseconds. Zero means no limit.
+ */
+int http_idle_timeout_ms();
+
+/**
+ * Returns the longest request body an HTTP connection buffers into
+ * Request::body before the handler runs. Longer bodies are streamed.
+ */
+std::size_t http_body_buffer_bytes();
+
+/**
+ * Returns the longest request body an HTTP server accepts, in bytes.
+ * Zero means no limit.
+ */
+std::size_t http_max_body_bytes();
+
+/**
+ * Returns how many HTTP connections may be open at once across all
+ * listeners. Zero means no limit.
+ */
+int http_max_connections();
+
+/**
+ * Returns how long a request head may take to arrive once its first byte
+ * has, in milliseconds. Zero means no limit.
+ */
+int http_header_timeout_ms();
+
+/**
+ * Returns how long each read of a request body may wait for data, in
+ * milliseconds. Zero means no limit.
+ */
+int http_body_timeout_ms();
+
+/**
+ * Returns how long each response write may take, in milliseconds. Zero
+ * means no limit.
+ */
+int http_write_timeout_ms();
+
+/**
+ * Returns the longest request line and headers an HTTP connection
+ * accepts, in bytes.
+ */
+std::size_t http_max_header_bytes();
+
+/**
+ * Returns the smallest response body an HTTP server compresses for a
+ * client that accepts gzip or deflate, in bytes. Zero means never.
+ */
+std::size_t http_compress_min_bytes();
+
+/**
+ * Returns the smallest response body compressed on the offload pool
+ * rather than on the connection's thread, in bytes. Zero means never.
+ */
+std::size_t http_compress_offload_bytes();
+
+/**
+ * Starts threads dedicated threads, each pinned to its own CPU core with
+ * its own io_context and single-threaded scheduler, and runs prepare on
+ * each. prepare returns the thread's main loop, or an empty function if
+ * the thread cannot start (a listener that failed to bind, say). The
+ * loops start only once every thread has prepared; if any failed, every
+ * thread exits instead and this returns false. Otherwise returns true
+ * once every loop has returned. The calling fiber waits without holding
+ * up its own thread, which may be a work-stealing worker.
+ */
+bool run_prepared_per_core(int threads, std::function<std::function<void()>()> prepare);
+
+/**
+ * Runs fn on threads dedicated per-core threads, as run_prepared_per_core()
+ * does, and returns
+ * once every copy has returned.
+ */
+void run_per_core(int threads, std::function<void()> fn);
 
 /**
  * Run a function in a fiber and wait for completion.
  * Assumes runtime is already initialized.
  */
-void run_in_fiber(std::function<void()> fn);
+void run_in_fiber(Task fn);
+
+/**
+ * Flushes output and ends the process with code, without tearing down
+ * the scheduler. Like Go, a program ends when main returns, even while
+ * goroutines are still parked on a socket or channel.
+ */
+[[noreturn]] void exit(int code);
+
+/**
+ * Spawn a new fiber (goroutine). The task is stored in the fiber's control
+ * block on its pooled stack, so no heap allocation happens for closures
+ * that fit in a Task.
+ */
+void spawn(Task fn);
+
+/**
+ * Spawns a fiber that stays on the calling thread for its whole life. It
+ * starts running at once, so no other worker can steal it first. For
+ * fibers that own sockets or timers on this thread's io_context.
+ */
+void spawn_pinned(Task fn);
+
+/**
+ * Keeps the calling fiber on its current thread while in scope. With
+ * several workers an unpinned fiber may be stolen by another thread
+ * whenever it suspends, but the completion handlers of its sockets and
+ * timers still run on the thread of the io_context that owns them. A
+ * fiber that shares state with such handlers pins itself first, before
+ * it opens them on io_context(). Nested guards are fine.
+ */
+class PinnedFiber {
+public:
+    PinnedFiber();
+    ~PinnedFiber();
+
+    PinnedFiber(const PinnedFiber&) = delete;
+    PinnedFiber& operator=(const PinnedFiber&) = delete;
+
+private:
+    bool pinned_;
+};
+
+/**
+ * Runs work on the blocking-offload thread pool and parks only the calling
+ * fiber until it finishes. Other fibers keep running on this thread.
+ * work must not throw; offload() wraps it to carry exceptions back.
+ */
+void offload_task(Task work);
 
 /**
- * Spawn a new fiber (goroutine).
+ * Runs a blocking call (file I/O, blocking FFI) off the fiber threads and
+ * returns its result. Exceptions thrown by fn are rethrown in the caller.
  */
-void spawn(std::function<void()> fn);
+template<typename Fn>
+auto offload(Fn&& fn) -> std::invoke_result_t<Fn&> {
+    using R = std::invoke_result_t<Fn&>;
+    std::exception_ptr error;
+
+    if constexpr (std::is_void_v<R>) {
+        offload_task([&fn, &error]() {
+            try {
+                fn();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        });
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    } else {
+        std::optional<R> result;
+
+        offload_task([&fn, &result, &error]() {
+            try {
+                result.emplace(fn());
+            } catch (...) {
+                error = std::current_exception();
+            }
+        });
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        return std::move(*result);
+    }
+}
 
 /**
  * Sleep for the specified milliseconds, yielding to other fibers.
+ * The fiber parks on its thread's timer wheel, at 1ms resolution.
  */
 void sleep_ms(int ms);
 
@@ -44,6 +44,55 @@
  * await app.listen(8080);
  */
 
+/**
+ * @nog_struct Writer
+ * @module http
+ * @description Writes the body of a streamed response, returned by req.stream(). HTTP/1.1 clients receive it with Transfer-Encoding: chunked. Small writes are coalesced into larger chunks, and each send suspends the handler until the client has taken the bytes, so a large response is produced in constant memory.
+ * @example
+ * fn report(http.Request req) -> http.Response {
+ *     w := req.stream(200, "text/csv");
+ *     for i in 0..100000 {
+ *         w.write("a,b,c\n");
+ *     }
+ *     return w.end();
+ * }
+ */
+
+/**
+ * @nog_struct Next
+ * @module http
+ * @description The rest of a middleware chain, handed to each middleware added with app.use(). A middleware is a function taking an http.Request and an http.Next and returning an http.Response. It is compiled as a template over what comes next, and its request is passed by reference, so a chain of middleware adds no indirect calls. The route's handler gets its own copy of the request, so a middleware can still read req after next.run(req) returns. A middleware can hand its next step on to other functions or methods that take an http.Next.
+ * @example
+ * fn timing(http.Request req, http.Next next) -> http.Response {
+ *     resp := next.run(req);
+ *     print(req.path);
+ *     return resp;
+ * }
+ */
+
+/**
+ * @nog_method run
+ * @type http.Next
+ * @description Runs the remaining middleware and the route's handler on the request, and returns their response. The handler gets its own copy of req, which is unchanged when run() returns.
+ * @param req http.Request - The request being handled
+ * @returns http.Response - The response from the rest of the chain
+ * @example return next.run(req);
+ */
+
+/**
+ * @nog_struct Client
+ * @module http
+ * @description HTTP/1.1 client with per-host keep-alive connection pools. A request suspends only the calling fiber while it connects, writes and reads, so fibers fanning out to upstreams wait in parallel. Each in-flight request uses a connection of its own, and finished ones are kept for reuse by later requests on the same thread, so the per-host limits apply per thread. Copies share the pools. Only http:// URLs are supported. Bodies sent with a gzip or deflate Content-Encoding are decompressed, and resp.header("Content-Encoding") still names the coding. Fields left out of the literal keep their defaults.
+ * @field timeout_ms int - Limit for the whole request, from connect to the last response byte, in milliseconds (default 30000; 0 = never)
+ * @field max_connections_per_host int - Requests beyond this many connections to one host wait for one to free up (default 0 = no limit)
+ * @field max_idle_per_host int - Idle keep-alive connections kept per host (default 32)
+ * @field idle_timeout_ms int - Idle connections unused for this long are closed instead of reused (default 30000; 0 = never)
+ * @field max_body_bytes int - Requests whose response body is longer, as sent or once decompressed, fail (default 67108864; 0 = no limit)
+ * @example
+ * client := http.Client { timeout_ms: 2000, max_connections_per_host: 64 };
+ * resp := client.get("http://127.0.0.1:9000/users/1") or return http.not_found();
+ */
+
 /**
  * @nog_fn text
  * @module http
@@ -73,11 +122,42 @@
  * }
  */
 
+/**
+ * @nog_fn file
+ * @module http
+ * @description Creates a 200 OK response that sends a file from a cached memory mapping, without copying it into a string. The Content-Type is inferred from the file extension. ETag and Last-Modified are sent, so conditional requests get 304 Not Modified, and single-range Range requests get 206 Partial Content. Returns a 404 response if the path is not a readable regular file.
+ * @param path str - Path of the file to send
+ * @returns http.Response - A file response
+ * @example return http.file("public/index.html");
+ */
+
+/**
+ * @nog_fn get
+ * @module http
+ * @description Sends a GET request through a shared http.Client with default settings and returns the response. Fails if the URL is not an http:// URL, the host cannot be reached, or the request takes longer than 30 seconds.
+ * @param url str - URL to request
+ * @returns http.Response or err - The response, whatever its status
+ * @example
+ * resp := http.get("http://127.0.0.1:9000/health") or return false;
+ * return resp.status == 200;
+ */
+
+/**
+ * @nog_fn post
+ * @module http
+ * @description Sends a POST request through a shared http.Client with default settings and returns the response.
+ * @param url str - URL to request
+ * @param content_type str - Content-Type of the body
+ * @param body str - Request body
+ * @returns http.Response or err - The response, whatever its status
+ * @example resp := http.post("http://127.0.0.1:9000/events", "application/json", "{}") or fail err;
+ */
+
 /**
  * @nog_fn serve
  * @module http
  * @async
- * @description Starts an HTTP server on the specified port with a single handler function.
+ * @description Starts an HTTP server on the specified port with a single handler function. Connections are kept alive between requests (pipelined requests included) until the client closes them or stays idle. Listener threads, connection limits, timeouts and compression are set under [runtime] in bishop.toml; see docs/reference/bishop_toml.md.
  * @param port int - Port number to listen on
  * @param handler fn(http.Request) -> http.Response - Handler function for all requests
  * @example
@@ -87,15 +167,135 @@
  * await http.serve(8080, handle);
  */
 
+/**
+ * @nog_method header
+ * @type http.Request
+ * @description Returns the value of a request header, matched case-insensitively, or an empty string if the request does not have it.
+ * @param name str - Header name
+ * @returns str - Header value
+ * @example
+ * agent := req.header("User-Agent");
+ */
+
+/**
+ * @nog_method param
+ * @type http.Request
+ * @description Returns a path parameter captured by the matched route, such as "id" for "/users/:id" or "*" for a bare wildcard, or an empty string if the route has no such parameter.
+ * @param name str - Parameter name
+ * @returns str - Parameter value
+ * @example
+ * // app.get("/users/:id", show_user);
+ * id := req.param("id");
+ */
+
+/**
+ * @nog_method read_body
+ * @type http.Request
+ * @description Returns the next piece of the request body, or an empty string once all of it has been read. Bodies up to `http_body_buffer_bytes` (set under [runtime] in bishop.toml, 1 MiB by default) are also in req.body, and the first call returns all of it. Longer bodies are not buffered: req.body is empty and each call reads up to one buffer from the connection, so an upload of any size is processed in constant memory. A body the handler leaves unread closes the connection after the response. Bodies longer than `http_max_body_bytes` are rejected with 413 Payload Too Large.
+ * @returns str - The next piece of the body
+ * @example
+ * chunk := req.read_body();
+ * while chunk != "" {
+ *     total = total + chunk.length();
+ *     chunk = req.read_body();
+ * }
+ */
+
+/**
+ * @nog_method stream
+ * @type http.Request
+ * @description Starts a streamed response with the given status and Content-Type and returns an http.Writer for its body. The response goes out as the handler writes it, so the client gets the first bytes before the whole body exists. Whatever the handler returns afterwards is not sent; return w.end().
+ * @param status int - HTTP status code
+ * @param content_type str - Content-Type header value
+ * @returns http.Writer - Writer for the response body
+ * @example w := req.stream(200, "text/plain");
+ */
+
+/**
+ * @nog_method header
+ * @type http.Response
+ * @description Returns the value of a header of a response received by http.get(), http.post() or an http.Client, matched case-insensitively, or an empty string if the response does not have it. Responses built by a handler have no received headers.
+ * @param name str - Header name
+ * @returns str - Header value
+ * @example
+ * length := resp.header("Content-Length");
+ */
+
+/**
+ * @nog_method write
+ * @type http.Writer
+ * @description Appends data to the response body. Returns false once the client has gone away, so a producer can stop early.
+ * @param data str - Body bytes to append
+ * @returns bool - False once the client has gone away
+ * @example w.write("line\n");
+ */
+
+/**
+ * @nog_method flush
+ * @type http.Writer
+ * @description Sends everything written so far, for when the client should see it before more is written. Returns false once the client has gone away.
+ * @returns bool - False once the client has gone away
+ * @example w.flush();
+ */
+
+/**
+ * @nog_method end
+ * @type http.Writer
+ * @description Finishes the response body and returns a response for the handler to return. A handler that returns without calling end() has its body finished for it.
+ * @returns http.Response - The response to return from the handler
+ * @example return w.end();
+ */
+
+/**
+ * @nog_method get
+ * @type http.Client
+ * @description Sends a GET request and returns the response. Fails if the URL is not an http:// URL, the host cannot be reached, or the request misses timeout_ms.
+ * @param url str - URL to request
+ * @returns http.Response or err - The response, whatever its status
+ * @example resp := client.get("http://127.0.0.1:9000/users/1") or fail err;
+ */
+
+/**
+ * @nog_method post
+ * @type http.Client
+ * @description Sends a POST request with the given body and returns the response.
+ * @param url str - URL to request
+ * @param content_type str - Content-Type of the body
+ * @param body str - Request body
+ * @returns http.Response or err - The response, whatever its status
+ * @example resp := client.post("http://127.0.0.1:9000/users", "application/json", body) or fail err;
+ */
+
+/**
+ * @nog_method request
+ * @type http.Client
+ * @description Sends a request with any method, such as PUT or DELETE. An empty content_type sends no Content-Type header. Idempotent requests that fail on a reused connection before any response arrives are retried once on a new connection.
+ * @param method str - HTTP method
+ * @param url str - URL to request
+ * @param content_type str - Content-Type of the body, or ""
+ * @param body str - Request body, or ""
+ * @returns http.Response or err - The response, whatever its status
+ * @example resp := client.request("DELETE", "http://127.0.0.1:9000/users/1", "", "") or fail err;
+ */
+
+/**
+ * @nog_method set_header
+ * @type http.Client
+ * @description Sends a header with every later request from this Client, replacing any value set for the same name before. Copies made afterwards keep it; copies made before do not.
+ * @param name str - Header name
+ * @param value str - Header value
+ * @example client.set_header("Authorization", "Bearer " + token);
+ */
+
 /**
  * @nog_method get
  * @type http.App
- * @description Registers a handler for GET requests at the specified path.
+ * @description Registers a handler for GET requests at the specified path. Segments written `:name` capture one path segment and a trailing `*` or `*name` captures the rest of the path; read them with req.param(). Static segments take precedence over params, and params over wildcards.
  * @param path str - URL path to match
  * @param handler fn(http.Request) -> http.Response - Handler function
  * @example
  * app.get("/", home);
- * app.get("/about", about);
+ * app.get("/users/:id", show_user);
  */
 
 /**
@@ -107,11 +307,71 @@
  * @example app.post("/submit", handle_submit);
  */
 
+/**
+ * @nog_method use
+ * @type http.App
+ * @description Adds a middleware around every route of the App. Middleware run in the order they were added, each inside the ones before it, and can answer a request themselves instead of calling next.run(). When the App is folded into a generated dispatcher, the compiler composes the chain into direct calls.
+ * @param middleware fn(http.Request, http.Next) -> http.Response - Middleware function
+ * @example
+ * fn require_token(http.Request req, http.Next next) -> http.Response {
+ *     if req.header("Authorization") == "" {
+ *         return http.Response { status: 401, content_type: "text/plain", body: "unauthorized" };
+ *     }
+ *     return next.run(req);
+ * }
+ *
+ * app.use(timing);
+ * app.use(require_token);
+ */
+
+/**
+ * @nog_method cache
+ * @type http.App
+ * @description Caches 200 responses to GET requests whose path starts with prefix, for ttl_ms milliseconds. The key is the path with its query string, plus any headers named with cache_vary(). A hit is answered with the stored response bytes, without routing, calling the handler or formatting the response. File and streamed responses are not cached. Requests carrying an Authorization or Cookie header bypass the cache, unless that header is named with cache_vary(), and responses with a Set-Cookie header are not stored. When prefixes overlap, the longest wins, and a ttl_ms of 0 excludes its prefix from caching.
+ * @param prefix str - Path prefix of the routes to cache
+ * @param ttl_ms int - How long a response stays cached, in milliseconds
+ * @example
+ * app.cache("/products/", 5000);
+ * app.cache("/products/cart", 0);
+ */
+
+/**
+ * @nog_method cache_vary
+ * @type http.App
+ * @description Adds a request header to the cache key, for routes whose response depends on it.
+ * @param header str - Request header name
+ * @example app.cache_vary("Accept-Language");
+ */
+
+/**
+ * @nog_method cache_limit
+ * @type http.App
+ * @description Sets how many bytes of responses the cache may hold, 64 MiB by default. The least recently used responses are evicted first.
+ * @param max_bytes int - Cache size limit in bytes
+ * @example app.cache_limit(16 * 1024 * 1024);
+ */
+
+/**
+ * @nog_method cache_hits
+ * @type http.App
+ * @description Returns how many requests were answered from the cache.
+ * @returns int - Cache hits so far
+ * @example print(app.cache_hits());
+ */
+
+/**
+ * @nog_method cache_misses
+ * @type http.App
+ * @description Returns how many cacheable requests were not in the cache, or found it expired.
+ * @returns int - Cache misses so far
+ * @example print(app.cache_misses());
+ */
+
 /**
  * @nog_method listen
  * @type http.App
  * @async
- * @description Starts the HTTP server and begins listening for requests.
+ * @description Starts the HTTP server and begins listening for requests. Connections are kept alive between requests (pipelined requests included) until the client closes them or stays idle. Listener threads, connection limits, timeouts and compression are set under [runtime] in bishop.toml; see docs/reference/bishop_toml.md.
  * @param port int - Port number to listen on
  * @example await app.listen(8080);
  */
@@ -144,6 +404,46 @@ unique_ptr<Program> create_http_module() {
     request->fields.push_back({"body", "str", ""});
     program->structs.push_back(move(request));
 
+    // Request :: header(self, str name) -> str
+    auto header_method = make_unique<MethodDef>();
+    header_method->struct_name = "Request";
+    header_method->name = "header";
+    header_method->visibility = Visibility::Public;
+    header_method->params.push_back({"http.Request", "self"});
+    header_method->params.push_back({"str", "name"});
+    header_method->return_type = "str";
+    program->methods.push_back(move(header_method));
+
+    // Request :: param(self, str name) -> str
+    auto param_method = make_unique<MethodDef>();
+    param_method->struct_name = "Request";
+    param_method->name = "param";
+    param_method->visibility = Visibility::Public;
+    param_method->params.push_back({"http.Request", "self"});
+    param_method->params.push_back({"str", "name"});
+    param_method->return_type = "str";
+    program->methods.push_back(move(param_method));
+
+    // Request :: read_body(self) -> str
+    auto read_body_method = make_unique<MethodDef>();
+    read_body_method->struct_name = "Request";
+    read_body_method->name = "read_body";
+    read_body_method->visibility = Visibility::Public;
+    read_body_method->params.push_back({"http.Request", "self"});
+    read_body_method->return_type = "str";
+    program->methods.push_back(move(read_body_method));
+
+    // Request :: stream(self, int status, str content_type) -> http.Writer
+    auto stream_method = make_unique<MethodDef>();
+    stream_method->struct_name = "Request";
+    stream_method->name = "stream";
+    stream_method->visibility = Visibility::Public;
+    stream_method->params.push_back({"http.Request", "self"});
+    stream_method->params.push_back({"int", "status"});
+    stream_method->params.push_back({"str", "content_type"});
+    stream_method->return_type = "http.Writer";
+    program->methods.push_back(move(stream_method));
+
     // Response :: struct { status int, content_type str, body str }
     auto response = make_unique<StructDef>();
     response->name = "Response";
@@ -153,6 +453,66 @@ unique_ptr<Program> create_http_module() {
     response->fields.push_back({"body", "str", ""});
     program->structs.push_back(move(response));
 
+    // Response :: header(self, str name) -> str
+    auto response_header_method = make_unique<MethodDef>();
+    response_header_method->struct_name = "Response";
+    response_header_method->name = "header";
+    response_header_method->visibility = Visibility::Public;
+    response_header_method->params.push_back({"http.Response", "self"});
+    response_header_method->params.push_back({"str", "name"});
+    response_header_method->return_type = "str";
+    program->methods.push_back(move(response_header_method));
+
+    // Writer :: struct { } (stream state lives on the connection)
+    auto writer_struct = make_unique<StructDef>();
+    writer_struct->name = "Writer";
+    writer_struct->visibility = Visibility::Public;
+    program->structs.push_back(move(writer_struct));
+
+    // Writer :: write(self, str data) -> bool
+    auto write_method = make_unique<MethodDef>();
+    write_method->struct_name = "Writer";
+    write_method->name = "write";
+    write_method->visibility = Visibility::Public;
+    write_method->params.push_back({"http.Writer", "self"});
+    write_method->params.push_back({"str", "data"});
+    write_method->return_type = "bool";
+    program->methods.push_back(move(write_method));
+
+    // Writer :: flush(self) -> bool
+    auto flush_method = make_unique<MethodDef>();
+    flush_method->struct_name = "Writer";
+    flush_method->name = "flush";
+    flush_method->visibility = Visibility::Public;
+    flush_method->params.push_back({"http.Writer", "self"});
+    flush_method->return_type = "bool";
+    program->methods.push_back(move(flush_method));
+
+    // Writer :: end(self) -> http.Response
+    auto end_method = make_unique<MethodDef>();
+    end_method->struct_name = "Writer";
+    end_method->name = "end";
+    end_method->visibility = Visibility::Public;
+    end_method->params.push_back({"http.Writer", "self"});
+    end_method->return_type = "http.Response";
+    program->methods.push_back(move(end_method));
+
+    // Next :: struct { } (a template over the next step in C++)
+    auto next_struct = make_unique<StructDef>();
+    next_struct->name = "Next";
+    next_struct->visibility = Visibility::Public;
+    program->structs.push_back(move(next_struct));
+
+    // Next :: run(self, http.Request req) -> http.Response
+    auto run_method = make_unique<MethodDef>();
+    run_method->struct_name = "Next";
+    run_method->name = "run";
+    run_method->visibility = Visibility::Public;
+    run_method->params.push_back({"http.Next", "self"});
+    run_method->params.push_back({"http.Request", "req"});
+    run_method->return_type = "http.Response";
+    program->methods.push_back(move(run_method));
+
     // fn text(str content) -> http.Response
     auto text_fn = make_unique<FunctionDef>();
     text_fn->name = "text";
@@ -176,6 +536,93 @@ unique_ptr<Program> create_http_module() {
     not_found_fn->return_type = "http.Response";
     program->functions.push_back(move(not_found_fn));
 
+    // fn file(str path) -> http.Response
+    auto file_fn = make_unique<FunctionDef>();
+    file_fn->name = "file";
+    file_fn->visibility = Visibility::Public;
+    file_fn->params.push_back({"str", "path"});
+    file_fn->return_type = "http.Response";
+    program->functions.push_back(move(file_fn));
+
+    // fn get(str url) -> http.Response or err
+    auto get_fn = make_unique<FunctionDef>();
+    get_fn->name = "get";
+    get_fn->visibility = Visibility::Public;
+    get_fn->params.push_back({"str", "url"});
+    get_fn->return_type = "http.Response";
+    get_fn->error_type = "err";
+    program->functions.push_back(move(get_fn));
+
+    // fn post(str url, str content_type, str body) -> http.Response or err
+    auto post_fn = make_unique<FunctionDef>();
+    post_fn->name = "post";
+    post_fn->visibility = Visibility::Public;
+    post_fn->params.push_back({"str", "url"});
+    post_fn->params.push_back({"str", "content_type"});
+    post_fn->params.push_back({"str", "body"});
+    post_fn->return_type = "http.Response";
+    post_fn->error_type = "err";
+    program->functions.push_back(move(post_fn));
+
+    // Client :: struct { timeout_ms int, max_connections_per_host int, max_idle_per_host int, idle_timeout_ms int, max_body_bytes int }
+    auto client_struct = make_unique<StructDef>();
+    client_struct->name = "Client";
+    client_struct->visibility = Visibility::Public;
+    client_struct->fields.push_back({"timeout_ms", "int", ""});
+    client_struct->fields.push_back({"max_connections_per_host", "int", ""});
+    client_struct->fields.push_back({"max_idle_per_host", "int", ""});
+    client_struct->fields.push_back({"idle_timeout_ms", "int", ""});
+    client_struct->fields.push_back({"max_body_bytes", "int", ""});
+    program->structs.push_back(move(client_struct));
+
+    // Client :: get(self, str url) -> http.Response or err
+    auto client_get = make_unique<MethodDef>();
+    client_get->struct_name = "Client";
+    client_get->name = "get";
+    client_get->visibility = Visibility::Public;
+    client_get->params.push_back({"http.Client", "self"});
+    client_get->params.push_back({"str", "url"});
+    client_get->return_type = "http.Response";
+    client_get->error_type = "err";
+    program->methods.push_back(move(client_get));
+
+    // Client :: post(self, str url, str content_type, str body) -> http.Response or err
+    auto client_post = make_unique<MethodDef>();
+    client_post->struct_name = "Client";
+    client_post->name = "post";
+    client_post->visibility = Visibility::Public;
+    client_post->params.push_back({"http.Client", "self"});
+    client_post->params.push_back({"str", "url"});
+    client_post->params.push_back({"str", "content_type"});
+    client_post->params.push_back({"str", "body"});
+    client_post->return_type = "http.Response";
+    client_post->error_type = "err";
+    program->methods.push_back(move(client_post));
+
+    // Client :: request(self, str method, str url, str content_type, str body) -> http.Response or err
+    auto client_request = make_unique<MethodDef>();
+    client_request->struct_name = "Client";
+    client_request->name = "request";
+    client_request->visibility = Visibility::Public;
+    client_request->params.push_back({"http.Client", "self"});
+    client_request->params.push_back({"str", "method"});
+    client_request->params.push_back({"str", "url"});
+    client_request->params.push_back({"str", "content_type"});
+    client_request->params.push_back({"str", "body"});
+    client_request->return_type = "http.Response";
+    client_request->error_type = "err";
+    program->methods.push_back(move(client_request));
+
+    // Client :: set_header(self, str name, str value)
+    auto client_set_header = make_unique<MethodDef>();
+    client_set_header->struct_name = "Client";
+    client_set_header->name = "set_header";
+    client_set_header->visibility = Visibility::Public;
+    client_set_header->params.push_back({"http.Client", "self"});
+    client_set_header->params.push_back({"str", "name"});
+    client_set_header->params.push_back({"str", "value"});
+    program->methods.push_back(move(client_set_header));
+
     // fn serve(int port, fn(http.Request) -> http.Response handler)
     auto serve_fn = make_unique<FunctionDef>();
     serve_fn->name = "serve";
@@ -210,6 +657,61 @@ unique_ptr<Program> create_http_module() {
     post_method->params.push_back({"fn(http.Request) -> http.Response", "handler"});
     program->methods.push_back(move(post_method));
 
+    // App :: use(self, fn(http.Request, http.Next) -> http.Response middleware)
+    auto use_method = make_unique<MethodDef>();
+    use_method->struct_name = "App";
+    use_method->name = "use";
+    use_method->visibility = Visibility::Public;
+    use_method->params.push_back({"http.App", "self"});
+    use_method->params.push_back({"fn(http.Request, http.Next) -> http.Response", "middleware"});
+    program->methods.push_back(move(use_method));
+
+    // App :: cache(self, str prefix, int ttl_ms)
+    auto cache_method = make_unique<MethodDef>();
+    cache_method->struct_name = "App";
+    cache_method->name = "cache";
+    cache_method->visibility = Visibility::Public;
+    cache_method->params.push_back({"http.App", "self"});
+    cache_method->params.push_back({"str", "prefix"});
+    cache_method->params.push_back({"int", "ttl_ms"});
+    program->methods.push_back(move(cache_method));
+
+    // App :: cache_vary(self, str header)
+    auto cache_vary_method = make_unique<MethodDef>();
+    cache_vary_method->struct_name = "App";
+    cache_vary_method->name = "cache_vary";
+    cache_vary_method->visibility = Visibility::Public;
+    cache_vary_method->params.push_back({"http.App", "self"});
+    cache_vary_method->params.push_back({"str", "header"});
+    program->methods.push_back(move(cache_vary_method));
+
+    // App :: cache_limit(self, int max_bytes)
+    auto cache_limit_method = make_unique<MethodDef>();
+    cache_limit_method->struct_name = "App";
+    cache_limit_method->name = "cache_limit";
+    cache_limit_method->visibility = Visibility::Public;
+    cache_limit_method->params.push_back({"http.App", "self"});
+    cache_limit_method->params.push_back({"int", "max_bytes"});
+    program->methods.push_back(move(cache_limit_method));
+
+    // App :: cache_hits(self) -> int
+    auto cache_hits_method = make_unique<MethodDef>();
+    cache_hits_method->struct_name = "App";
+    cache_hits_method->name = "cache_hits";
+    cache_hits_method->visibility = Visibility::Public;
+    cache_hits_method->params.push_back({"http.App", "self"});
+    cache_hits_method->return_type = "int";
+    program->methods.push_back(move(cache_hits_method));
+
+    // App :: cache_misses(self) -> int
+    auto cache_misses_method = make_unique<MethodDef>();
+    cache_misses_method->struct_name = "App";
+    cache_misses_method->name = "cache_misses";
+    cache_misses_method->visibility = Visibility::Public;
+    cache_misses_method->params.push_back({"http.App", "self"});
+    cache_misses_method->return_type = "int";
+    program->methods.push_back(move(cache_misses_method));
+
     // App :: listen(self, int port)
     auto listen_method = make_unique<MethodDef>();
     listen_method->struct_name = "App";
@@ -0,0 +1,4 @@
+// @error Channel capacity must be int
+fn test() {
+    ch := Channel<int>("4");
+}
@@ -120,6 +120,93 @@ fn test_send_recv() {
     assert_eq(val, 42);
 }
 
+fn send_many(Channel<int> ch, int count) {
+    for i in 0..count {
+        ch.send(i);
+    }
+}
+
+fn test_buffered_channel_capacity() {
+    ch := Channel<int>(3);
+
+    // Fits in the buffer without a receiver
+    ch.send(1);
+    ch.send(2);
+    ch.send(3);
+
+    assert_eq(ch.recv(), 1);
+    assert_eq(ch.recv(), 2);
+    assert_eq(ch.recv(), 3);
+}
+
+fn test_unbuffered_channel() {
+    ch := Channel<int>(0);
+
+    go send_many(ch, 5);
+
+    total := 0;
+
+    for i in 0..5 {
+        total = total + ch.recv();
+    }
+
+    assert_eq(total, 10);
+}
+
+fn test_go_evaluates_args_at_spawn() {
+    ch := Channel<int>(5);
+
+    // Each goroutine gets the value of i at its spawn
+    for i in 0..5 {
+        go sender(ch, i);
+    }
+
+    total := 0;
+
+    for i in 0..5 {
+        total = total + ch.recv();
+    }
+
+    assert_eq(total, 10);
+}
+
+Batch :: struct {
+    items List<int>
+}
+
+fn send_batch(Channel<Batch> ch) {
+    items := List<int>();
+
+    for i in 0..1000 {
+        items.append(i);
+    }
+
+    batch := Batch { items: items };
+
+    // Last use of batch, so it is moved into the channel
+    ch.send(batch);
+}
+
+fn test_send_moves_last_use() {
+    ch := Channel<Batch>();
+
+    go send_batch(ch);
+
+    batch := ch.recv();
+    assert_eq(batch.items.length(), 1000);
+}
+
+fn test_send_copies_live_value() {
+    ch := Channel<Batch>(1);
+    batch := Batch { items: [1, 2, 3] };
+
+    ch.send(batch);
+
+    // Still used after the send, so it must have been copied
+    assert_eq(batch.items.length(), 3);
+    assert_eq(ch.recv().items.length(), 3);
+}
+
 // ============================================
 // Select Statement
 // ============================================
@@ -149,6 +236,32 @@ fn test_select_recv() {
     assert_eq(selected, 41);
 }
 
+fn delayed_sender(Channel<int> ch, int val) {
+    sleep(20);
+    ch.send(val);
+}
+
+fn test_select_waits_for_sender() {
+    ch1 := Channel<int>();
+    ch2 := Channel<int>();
+
+    // Nothing is ready when select starts, so it must park and be woken
+    go delayed_sender(ch2, 7);
+
+    selected := 0;
+
+    select {
+        case val := ch1.recv() {
+            selected = val;
+        }
+        case val := ch2.recv() {
+            selected = val + 100;
+        }
+    }
+
+    assert_eq(selected, 107);
+}
+
 // ============================================
 // Sync test
 // ============================================
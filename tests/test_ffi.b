@@ -1,6 +1,7 @@
 @extern("c") fn puts(cstr s) -> cint;
 @extern("m") fn sqrt(f64 x) -> f64;
 @extern("m") fn floor(f64 x) -> f64;
+@extern("c", blocking) fn usleep(cint usec) -> cint;
 
 fn test_puts() {
     puts("Hello from C FFI!");
@@ -16,3 +17,8 @@ fn test_floor() {
     result := floor(3.7);
     assert_eq(result, 3.0);
 }
+
+fn test_blocking_extern() {
+    rc := usleep(1000);
+    assert_eq(rc, 0);
+}
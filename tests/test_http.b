@@ -13,6 +13,21 @@ fn about(http.Request req) -> http.Response {
     return http.text("About page");
 }
 
+// Middleware for http.App
+fn require_token(http.Request req, http.Next next) -> http.Response {
+    if req.header("Authorization") == "" {
+        return http.Response { status: 401, content_type: "text/plain", body: "unauthorized" };
+    }
+
+    return next.run(req);
+}
+
+// Reads the request after the rest of the chain has handled it
+fn stamp_path(http.Request req, http.Next next) -> http.Response {
+    resp := next.run(req);
+    return http.text(resp.body + " at " + req.path);
+}
+
 // Test App-based routing API
 fn test_app_routing() {
     app := http.App {};
@@ -45,6 +60,19 @@ fn test_http_not_found() {
     assert_eq(resp.body, "Not Found");
 }
 
+// Test http.file response
+fn test_http_file() {
+    resp := http.file("tests/test_http.b");
+    assert_eq(resp.status, 200);
+    assert_eq(resp.content_type, "application/octet-stream");
+}
+
+// Test http.file for a missing file
+fn test_http_file_missing() {
+    resp := http.file("nonexistent_file_12345.txt");
+    assert_eq(resp.status, 404);
+}
+
 // Test Request struct
 fn test_request_struct() {
     req := http.Request { method: "GET", path: "/test", body: "" };
@@ -53,6 +81,91 @@ fn test_request_struct() {
     assert_eq(req.body, "");
 }
 
+// Test header lookup on a request without headers
+fn test_request_header_missing() {
+    req := http.Request { method: "GET", path: "/test", body: "" };
+    assert_eq(req.header("Content-Type"), "");
+}
+
+// Test reading a buffered body through read_body
+fn test_request_read_body() {
+    req := http.Request { method: "POST", path: "/upload", body: "hello" };
+    assert_eq(req.read_body(), "hello");
+    assert_eq(req.read_body(), "");
+    assert_eq(req.body, "hello");
+}
+
+// Test a streamed response on a request without a connection
+fn test_request_stream() {
+    req := http.Request { method: "GET", path: "/report", body: "" };
+    w := req.stream(200, "text/csv");
+    assert_eq(w.write("a,b\n"), false);
+    resp := w.end();
+    assert_eq(resp.status, 200);
+    assert_eq(resp.content_type, "text/csv");
+}
+
+fn client_status(str url) -> int {
+    resp := http.get(url) or return 0;
+    return resp.status;
+}
+
+// Waits for a server started with go to answer url, polling for up to
+// 5 seconds, so tests do not depend on how fast the listener starts
+fn await_server(str url) {
+    tries := 0;
+
+    while client_status(url) == 0 {
+        if tries == 500 {
+            return;
+        }
+
+        sleep(10);
+        tries = tries + 1;
+    }
+}
+
+fn client_body(str url) -> str {
+    resp := http.get(url) or return "";
+    return resp.body;
+}
+
+fn show_user(http.Request req) -> http.Response {
+    return http.text("user " + req.param("id"));
+}
+
+fn show_rest(http.Request req) -> http.Response {
+    return http.text("static " + req.param("rest"));
+}
+
+fn serve_params(int port) {
+    app := http.App {};
+    app.get("/users/:id", show_user);
+    app.get("/users/me", about);
+    app.get("/static/*rest", show_rest);
+    app.listen(port);
+}
+
+// Test that a static segment beats a :param and that * takes the rest
+fn test_app_param_routes() {
+    go serve_params(18414);
+    await_server("http://127.0.0.1:18414/");
+    assert_eq(client_body("http://127.0.0.1:18414/users/me"), "About page");
+    assert_eq(client_body("http://127.0.0.1:18414/users/42"), "user 42");
+    assert_eq(client_body("http://127.0.0.1:18414/static/a/b"), "static a/b");
+}
+
+// Test configuring the response cache before any request
+fn test_app_cache() {
+    app := http.App {};
+    app.get("/products", home);
+    app.cache("/products", 5000);
+    app.cache_vary("Accept-Language");
+    app.cache_limit(1048576);
+    assert_eq(app.cache_hits(), 0);
+    assert_eq(app.cache_misses(), 0);
+}
+
 // Test Response struct
 fn test_response_struct() {
     resp := http.Response { status: 201, content_type: "text/html", body: "<h1>Hi</h1>" };
@@ -60,3 +173,336 @@ fn test_response_struct() {
     assert_eq(resp.content_type, "text/html");
     assert_eq(resp.body, "<h1>Hi</h1>");
 }
+
+// Test that the client rejects URLs it cannot request
+fn test_http_get_bad_url() {
+    assert_eq(client_status("https://example.com/"), 0);
+    assert_eq(client_status("ftp://example.com/"), 0);
+    assert_eq(client_status("http:///nohost"), 0);
+}
+
+// Test a request to a port nothing listens on
+fn test_http_get_refused() {
+    assert_eq(client_status("http://127.0.0.1:1/"), 0);
+}
+
+// Test Client settings and a failing request through it
+fn test_http_client() {
+    client := http.Client { timeout_ms: 500, max_connections_per_host: 4 };
+    assert_eq(client.timeout_ms, 500);
+    assert_eq(client.max_idle_per_host, 32);
+    resp := client.post("http://127.0.0.1:1/", "text/plain", "hi") or return;
+    assert_eq(resp.status, 0);
+}
+
+// Apps served from ordinary functions, as a program would. This one only
+// registers literal paths, so listen() becomes a generated dispatcher
+fn serve_static(int port) {
+    app := http.App {};
+    app.get("/", home);
+    app.get("/about", about);
+    app.listen(port);
+}
+
+// The :id route keeps this App on the runtime router
+fn serve_routed(int port) {
+    app := http.App {};
+    app.get("/", home);
+    app.get("/users/:id", show_user);
+    app.listen(port);
+}
+
+// Test requests to an App folded into a generated dispatcher
+fn test_app_static_dispatch() {
+    go serve_static(18401);
+    await_server("http://127.0.0.1:18401/");
+    assert_eq(client_body("http://127.0.0.1:18401/about"), "About page");
+    assert_eq(client_status("http://127.0.0.1:18401/missing"), 404);
+}
+
+// Test requests to an App served by the runtime router
+fn test_app_runtime_router() {
+    go serve_routed(18402);
+    await_server("http://127.0.0.1:18402/");
+    assert_eq(client_body("http://127.0.0.1:18402/users/42"), "user 42");
+    assert_eq(client_status("http://127.0.0.1:18402/users"), 404);
+}
+
+// Methods can take the next step too, as helpers for a middleware
+Gate :: struct { prefix str }
+
+Gate :: pass(self, http.Request req, http.Next next) -> http.Response {
+    if req.path.starts_with(self.prefix) {
+        return next.run(req);
+    }
+
+    return http.Response { status: 403, content_type: "text/plain", body: "forbidden" };
+}
+
+fn users_only(http.Request req, http.Next next) -> http.Response {
+    gate := Gate { prefix: "/users" };
+    return gate.pass(req, next);
+}
+
+// GETs url with an X-Tag header, plus credential set to "secret" unless it is ""
+fn tagged_get(str url, str tag, str credential) -> str {
+    client := http.Client {};
+    client.set_header("X-Tag", tag);
+
+    if credential != "" {
+        client.set_header(credential, "secret");
+    }
+
+    resp := client.get(url) or return "";
+    return resp.body;
+}
+
+// Middleware around literal routes, composed into direct calls
+fn serve_guarded(int port) {
+    app := http.App {};
+    app.use(stamp_path);
+    app.use(require_token);
+    app.get("/", home);
+    app.listen(port);
+}
+
+// Middleware in front of the runtime router
+fn serve_guarded_routes(int port) {
+    app := http.App {};
+    app.use(stamp_path);
+    app.use(users_only);
+    app.use(require_token);
+    app.get("/users/:id", show_user);
+    app.listen(port);
+}
+
+// Test middleware answering requests in a generated dispatcher
+fn test_app_middleware_static() {
+    go serve_guarded(18403);
+    await_server("http://127.0.0.1:18403/");
+    assert_eq(client_status("http://127.0.0.1:18403/"), 401);
+    assert_eq(client_body("http://127.0.0.1:18403/"), "unauthorized at /");
+    assert_eq(tagged_get("http://127.0.0.1:18403/", "", "Authorization"), "Hello World at /");
+}
+
+// Test middleware answering requests in front of the runtime router
+fn test_app_middleware_routed() {
+    go serve_guarded_routes(18404);
+    await_server("http://127.0.0.1:18404/");
+    assert_eq(client_status("http://127.0.0.1:18404/users/42"), 401);
+    assert_eq(client_status("http://127.0.0.1:18404/about"), 403);
+    assert_eq(tagged_get("http://127.0.0.1:18404/users/42", "", "Authorization"), "user 42 at /users/42");
+}
+
+fn send_source(http.Request req) -> http.Response {
+    return http.file("tests/test_http.b");
+}
+
+fn serve_source(int port) {
+    http.serve(port, send_source);
+}
+
+// Test that a HEAD for a file gets the head a GET would, and no body
+fn test_http_head_file() or err {
+    go serve_source(18405);
+    await_server("http://127.0.0.1:18405/");
+    client := http.Client { max_connections_per_host: 1 };
+    probe := client.request("HEAD", "http://127.0.0.1:18405/", "", "") or fail err;
+    got := client.get("http://127.0.0.1:18405/") or fail err;
+    assert_eq(probe.status, 200);
+    assert_eq(probe.body, "");
+    assert_eq(probe.header("Content-Length") != "", true);
+    assert_eq(probe.header("Content-Length"), got.header("Content-Length"));
+    assert_eq(probe.header("ETag"), got.header("ETag"));
+    assert_eq(got.body.starts_with("// ====="), true);
+}
+
+// Handlers that echo the X-Tag request header, so a cached response shows
+// the tag of the request that filled the cache
+fn tagged(http.Request req) -> http.Response {
+    return http.text("tag " + req.header("X-Tag"));
+}
+
+fn tagged_large(http.Request req) -> http.Response {
+    body := "tag " + req.header("X-Tag") + " ";
+
+    for i in 0..2000 {
+        body = body + "x";
+    }
+
+    return http.text(body);
+}
+
+fn serve_cached(int port) {
+    app := http.App {};
+    app.get("/products", tagged);
+    app.get("/fresh", tagged);
+    app.get("/brief", tagged);
+    app.get("/big", tagged_large);
+    app.cache("/products", 60000);
+    app.cache("/brief", 100);
+    app.cache("/big", 60000);
+    // 16 shards of 3000 bytes each hold one /big response apiece
+    app.cache_limit(48000);
+    app.listen(port);
+}
+
+// Test that a cached route answers from the cache and an uncached one does not
+fn test_app_cache_hit() {
+    go serve_cached(18406);
+    await_server("http://127.0.0.1:18406/");
+    assert_eq(tagged_get("http://127.0.0.1:18406/products", "one", ""), "tag one");
+    assert_eq(tagged_get("http://127.0.0.1:18406/products", "two", ""), "tag one");
+    assert_eq(tagged_get("http://127.0.0.1:18406/products?page=2", "three", ""), "tag three");
+    assert_eq(tagged_get("http://127.0.0.1:18406/fresh", "one", ""), "tag one");
+    assert_eq(tagged_get("http://127.0.0.1:18406/fresh", "two", ""), "tag two");
+}
+
+// Test that an entry is served until its TTL runs out, then refilled
+fn test_app_cache_ttl() {
+    go serve_cached(18407);
+    await_server("http://127.0.0.1:18407/");
+    assert_eq(tagged_get("http://127.0.0.1:18407/brief", "one", ""), "tag one");
+    assert_eq(tagged_get("http://127.0.0.1:18407/brief", "two", ""), "tag one");
+    sleep(150);
+    assert_eq(tagged_get("http://127.0.0.1:18407/brief", "three", ""), "tag three");
+}
+
+// Test that entries are evicted at the cache limit. 17 keys over 16 shards
+// that hold one entry each means at least one misses the second time
+fn test_app_cache_eviction() {
+    go serve_cached(18408);
+    await_server("http://127.0.0.1:18408/");
+    keys := ["a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m", "n", "o", "p", "q"];
+
+    for key in keys {
+        tagged_get("http://127.0.0.1:18408/big?k=" + key, "one", "");
+    }
+
+    misses := 0;
+
+    for key in keys {
+        if tagged_get("http://127.0.0.1:18408/big?k=" + key, "two", "").starts_with("tag two") {
+            misses = misses + 1;
+        }
+    }
+
+    assert_eq(misses > 0, true);
+}
+
+// Test that requests with credentials neither read nor fill the cache
+fn test_app_cache_credentials() {
+    go serve_cached(18409);
+    await_server("http://127.0.0.1:18409/");
+    assert_eq(tagged_get("http://127.0.0.1:18409/products", "one", "Authorization"), "tag one");
+    assert_eq(tagged_get("http://127.0.0.1:18409/products", "two", ""), "tag two");
+    assert_eq(tagged_get("http://127.0.0.1:18409/products", "three", "Cookie"), "tag three");
+    assert_eq(tagged_get("http://127.0.0.1:18409/products", "four", ""), "tag two");
+}
+
+// bishop.toml sets http_compress_min_bytes = 1024 for these tests
+fn long_body() -> str {
+    body := "";
+
+    for i in 0..200 {
+        body = body + "compress me ";
+    }
+
+    return body;
+}
+
+fn send_long(http.Request req) -> http.Response {
+    return http.text(long_body());
+}
+
+fn send_short(http.Request req) -> http.Response {
+    return http.text("too short to compress");
+}
+
+fn serve_compressed(int port) {
+    app := http.App {};
+    app.get("/long", send_long);
+    app.get("/short", send_short);
+    app.listen(port);
+}
+
+// GETs url with the given Accept-Encoding and returns the Content-Encoding
+fn coding_for(str url, str accept) -> str {
+    client := http.Client {};
+    client.set_header("Accept-Encoding", accept);
+    resp := client.get(url) or return "failed";
+    return resp.header("Content-Encoding");
+}
+
+// Test which coding each Accept-Encoding header gets
+fn test_http_accept_encoding() {
+    go serve_compressed(18410);
+    await_server("http://127.0.0.1:18410/");
+    url := "http://127.0.0.1:18410/long";
+    assert_eq(coding_for(url, "gzip"), "gzip");
+    assert_eq(coding_for(url, "x-gzip"), "gzip");
+    assert_eq(coding_for(url, "deflate"), "deflate");
+    assert_eq(coding_for(url, "deflate, gzip"), "gzip");
+    assert_eq(coding_for(url, "gzip;q=0, deflate"), "deflate");
+    assert_eq(coding_for(url, "gzip; q=0.5"), "gzip");
+    assert_eq(coding_for(url, "*"), "gzip");
+    assert_eq(coding_for(url, "*, gzip;q=0"), "deflate");
+    assert_eq(coding_for(url, "*;q=0"), "");
+    assert_eq(coding_for(url, "gzip;q=0, deflate;q=0.000"), "");
+    assert_eq(coding_for(url, "br"), "");
+}
+
+// Test that bodies under http_compress_min_bytes are sent as they are
+fn test_http_compress_threshold() or err {
+    go serve_compressed(18411);
+    await_server("http://127.0.0.1:18411/");
+    client := http.Client {};
+    client.set_header("Accept-Encoding", "gzip");
+    small := client.get("http://127.0.0.1:18411/short") or fail err;
+    large := client.get("http://127.0.0.1:18411/long") or fail err;
+    assert_eq(small.header("Content-Encoding"), "");
+    assert_eq(small.header("Vary"), "");
+    assert_eq(small.body, "too short to compress");
+    assert_eq(large.header("Content-Encoding"), "gzip");
+    assert_eq(large.header("Vary"), "Accept-Encoding");
+}
+
+// Test that compressed bodies inflate back to the original. The client
+// decodes them, and Content-Length shows the compressed size was sent
+fn test_http_compress_round_trip() or err {
+    go serve_compressed(18412);
+    await_server("http://127.0.0.1:18412/");
+    plain := http.get("http://127.0.0.1:18412/long") or fail err;
+    gzip_client := http.Client {};
+    gzip_client.set_header("Accept-Encoding", "gzip");
+    deflate_client := http.Client {};
+    deflate_client.set_header("Accept-Encoding", "deflate");
+    zipped := gzip_client.get("http://127.0.0.1:18412/long") or fail err;
+    deflated := deflate_client.get("http://127.0.0.1:18412/long") or fail err;
+    assert_eq(plain.header("Content-Encoding"), "");
+    assert_eq(plain.body, long_body());
+    assert_eq(zipped.header("Content-Encoding"), "gzip");
+    assert_eq(zipped.body, long_body());
+    assert_eq(zipped.header("Content-Length") != plain.header("Content-Length"), true);
+    assert_eq(deflated.header("Content-Encoding"), "deflate");
+    assert_eq(deflated.body, long_body());
+    assert_eq(deflated.header("Content-Length") != plain.header("Content-Length"), true);
+}
+
+fn body_through(http.Client client, str url) -> str {
+    resp := client.get(url) or return "failed";
+    return resp.body;
+}
+
+// Test that max_body_bytes bounds response bodies as sent and as inflated
+fn test_http_client_max_body() {
+    go serve_compressed(18413);
+    await_server("http://127.0.0.1:18413/");
+    plain := http.Client { max_body_bytes: 1000 };
+    zipped := http.Client { max_body_bytes: 1000 };
+    zipped.set_header("Accept-Encoding", "gzip");
+    assert_eq(body_through(plain, "http://127.0.0.1:18413/short"), "too short to compress");
+    assert_eq(body_through(plain, "http://127.0.0.1:18413/long"), "failed");
+    // The gzip body is far under the limit until it is inflated
+    assert_eq(body_through(zipped, "http://127.0.0.1:18413/long"), "failed");
+}
@@ -0,0 +1,454 @@
+/**
+ * @file bench_http.cpp
+ * @brief HTTP load generator behind `bishop bench-http`.
+ *
+ * Runs on the same fiber runtime as Bishop servers: run_per_core() gives
+ * each load thread its own io_context, and every connection is a fiber
+ * that writes `pipeline` requests in one gathered write, then reads until
+ * llhttp has parsed as many responses. Latency runs from that write to
+ * each response's last byte and goes into a per-thread histogram; the
+ * histograms are merged once all threads finish.
+ */
+
+#include "tools/bench_http.hpp"
+
+#include <bishop/http.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+using tcp = boost::asio::ip::tcp;
+
+// ============================================================================
+// Histogram
+// ============================================================================
+
+/**
+ * Bucket of a value: values below 32 get their own bucket, larger ones
+ * keep their top SUB_BITS + 1 significant bits.
+ */
+static std::size_t bucket_index(std::uint64_t value) {
+    constexpr std::uint64_t sub_count = 1 << Histogram::SUB_BITS;
+
+    if (value < sub_count) {
+        return static_cast<std::size_t>(value);
+    }
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - Histogram::SUB_BITS;
+    return (static_cast<std::size_t>(shift + 1) << Histogram::SUB_BITS) +
+           static_cast<std::size_t>((value >> shift) & (sub_count - 1));
+}
+
+/**
+ * Smallest value that lands in bucket `index`.
+ */
+static std::uint64_t bucket_floor(std::size_t index) {
+    constexpr std::size_t sub_count = 1 << Histogram::SUB_BITS;
+
+    if (index < sub_count) {
+        return index;
+    }
+
+    int shift = static_cast<int>(index >> Histogram::SUB_BITS) - 1;
+    return static_cast<std::uint64_t>(sub_count + (index & (sub_count - 1))) << shift;
+}
+
+void Histogram::record(std::uint64_t ns) {
+    counts_[bucket_index(ns)]++;
+    count_++;
+    max_ = std::max(max_, ns);
+    sum_ += ns;
+}
+
+void Histogram::merge(const Histogram& other) {
+    for (std::size_t i = 0; i < BUCKETS; i++) {
+        counts_[i] += other.counts_[i];
+    }
+
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+}
+
+std::uint64_t Histogram::percentile(double q) const {
+    if (count_ == 0) {
+        return 0;
+    }
+
+    auto rank = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(count_)));
+    rank = std::clamp<std::uint64_t>(rank, 1, count_);
+    std::uint64_t seen = 0;
+
+    for (std::size_t i = 0; i < BUCKETS; i++) {
+        seen += counts_[i];
+
+        if (seen >= rank) {
+            // Report the bucket's upper edge, never past the largest sample.
+            std::uint64_t top = i + 1 < BUCKETS ? bucket_floor(i + 1) - 1 : max_;
+            return std::min(top, max_);
+        }
+    }
+
+    return max_;
+}
+
+double Histogram::mean() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_ / count_);
+}
+
+// ============================================================================
+// Load generator
+// ============================================================================
+
+namespace {
+
+/**
+ * Counters of one load thread. Every connection fiber on the thread
+ * shares it; the thread's scheduler is single-threaded, so no locking.
+ */
+struct ThreadStats {
+    std::uint64_t requests = 0;
+    std::uint64_t non_success = 0;
+    std::uint64_t errors = 0;
+    std::uint64_t connects = 0;
+    Histogram latency;
+};
+
+/**
+ * llhttp response parser state for one connection.
+ */
+struct ResponseProbe {
+    llhttp_t parser;
+    ThreadStats* stats = nullptr;
+    Clock::time_point sent;
+    int completed = 0;
+};
+
+int on_response_complete(llhttp_t* parser) {
+    auto* probe = static_cast<ResponseProbe*>(parser->data);
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - probe->sent);
+    probe->stats->latency.record(static_cast<std::uint64_t>(elapsed.count()));
+    probe->stats->requests++;
+
+    if (parser->status_code < 200 || parser->status_code >= 400) {
+        probe->stats->non_success++;
+    }
+
+    probe->completed++;
+    return 0;
+}
+
+const llhttp_settings_t& response_settings() {
+    static const llhttp_settings_t settings = []() {
+        llhttp_settings_t s;
+        llhttp_settings_init(&s);
+        s.on_message_complete = on_response_complete;
+        return s;
+    }();
+
+    return settings;
+}
+
+/**
+ * The bytes written per round trip: `pipeline` copies of one request.
+ */
+std::string build_batch(const Options& opts) {
+    std::string request = "GET " + opts.path + " HTTP/1.1\r\n";
+    request += "Host: " + opts.host + ":" + std::to_string(opts.port) + "\r\n";
+
+    if (!opts.keep_alive) {
+        request += "Connection: close\r\n";
+    }
+
+    request += "\r\n";
+
+    std::string batch;
+    int depth = opts.keep_alive ? opts.pipeline : 1;
+
+    for (int i = 0; i < depth; i++) {
+        batch += request;
+    }
+
+    return batch;
+}
+
+/**
+ * Drives one connection until `end`: connect, then write a batch and read
+ * its responses until the deadline or an error, reconnecting after errors
+ * and, without keep-alive, after every response. Failures after the
+ * deadline are the watchdog closing the socket and are not counted.
+ */
+void drive_connection(const Options& opts, const std::string& batch, int depth,
+                      tcp::socket& socket, ThreadStats& stats, Clock::time_point end) {
+    tcp::endpoint endpoint(boost::asio::ip::make_address(opts.host), static_cast<unsigned short>(opts.port));
+    std::vector<char> buffer(64 * 1024);
+    ResponseProbe probe;
+    probe.stats = &stats;
+
+    auto fail = [&]() {
+        if (Clock::now() < end) {
+            stats.errors++;
+        }
+    };
+
+    while (Clock::now() < end) {
+        boost::system::error_code ec;
+
+        if (socket.is_open()) {
+            socket.close(ec);
+        }
+
+        socket.async_connect(endpoint, boost::fibers::asio::yield[ec]);
+
+        if (ec) {
+            fail();
+            boost::this_fiber::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        stats.connects++;
+        socket.set_option(tcp::no_delay(true), ec);
+        llhttp_init(&probe.parser, HTTP_RESPONSE, &response_settings());
+        probe.parser.data = &probe;
+
+        while (Clock::now() < end) {
+            probe.completed = 0;
+            probe.sent = Clock::now();
+            boost::asio::async_write(socket, boost::asio::buffer(batch), boost::fibers::asio::yield[ec]);
+
+            if (ec) {
+                break;
+            }
+
+            while (probe.completed < depth) {
+                std::size_t n = socket.async_read_some(boost::asio::buffer(buffer), boost::fibers::asio::yield[ec]);
+
+                if (ec) {
+                    break;
+                }
+
+                if (llhttp_execute(&probe.parser, buffer.data(), n) != HPE_OK) {
+                    ec = boost::asio::error::invalid_argument;
+                    break;
+                }
+            }
+
+            if (ec || !opts.keep_alive) {
+                break;
+            }
+        }
+
+        if (ec) {
+            fail();
+        }
+    }
+
+    boost::system::error_code ignored;
+    socket.close(ignored);
+}
+
+}  // namespace
+
+Report run(const Options& opts) {
+    int threads = std::max(1, opts.threads);
+    int depth = opts.keep_alive ? std::max(1, opts.pipeline) : 1;
+    std::string batch = build_batch(opts);
+
+    Report report;
+    std::mutex report_mutex;
+    std::atomic<int> next_thread{0};
+
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opts.duration));
+
+    // One worker: run() returns here instead of ending the process.
+    bishop::rt::RuntimeConfig config;
+    config.workers = 1;
+
+    bishop::rt::run([&]() {
+        bishop::rt::run_per_core(threads, [&]() {
+            int index = next_thread++;
+            int connections = opts.connections / threads + (index < opts.connections % threads ? 1 : 0);
+
+            ThreadStats stats;
+            std::vector<tcp::socket> sockets;
+            sockets.reserve(connections);
+
+            for (int i = 0; i < connections; i++) {
+                sockets.emplace_back(bishop::rt::io_context());
+            }
+
+            std::vector<boost::fibers::fiber> fibers;
+            fibers.reserve(connections);
+
+            for (auto& socket : sockets) {
+                fibers.emplace_back([&]() { drive_connection(opts, batch, depth, socket, stats, end); });
+            }
+
+            // A stalled server must not hang the run: a second after the
+            // deadline, close whatever is still waiting on it.
+            boost::asio::steady_timer timer(bishop::rt::io_context());
+            timer.expires_at(end + std::chrono::seconds(1));
+
+            boost::fibers::fiber watchdog([&]() {
+                boost::system::error_code ec;
+                timer.async_wait(boost::fibers::asio::yield[ec]);
+
+                if (ec == boost::asio::error::operation_aborted) {
+                    return;
+                }
+
+                for (auto& socket : sockets) {
+                    socket.close(ec);
+                }
+            });
+
+            for (auto& fiber : fibers) {
+                fiber.join();
+            }
+
+            timer.cancel();
+            watchdog.join();
+
+            std::lock_guard<std::mutex> lock(report_mutex);
+            report.requests += stats.requests;
+            report.non_success += stats.non_success;
+            report.errors += stats.errors;
+            report.connects += stats.connects;
+            report.latency.merge(stats.latency);
+        });
+    }, config);
+
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return report;
+}
+
+/**
+ * Formats nanoseconds with the largest unit that keeps a leading digit.
+ */
+static std::string format_ns(double ns) {
+    char text[32];
+
+    if (ns < 1e3) {
+        std::snprintf(text, sizeof(text), "%.0fns", ns);
+    } else if (ns < 1e6) {
+        std::snprintf(text, sizeof(text), "%.2fus", ns / 1e3);
+    } else if (ns < 1e9) {
+        std::snprintf(text, sizeof(text), "%.2fms", ns / 1e6);
+    } else {
+        std::snprintf(text, sizeof(text), "%.2fs", ns / 1e9);
+    }
+
+    return text;
+}
+
+void print(const Report& report, std::ostream& out) {
+    char line[128];
+    double rps = report.seconds > 0 ? static_cast<double>(report.requests) / report.seconds : 0.0;
+
+    std::snprintf(line, sizeof(line), "  %-12s %llu in %.2fs\n", "Requests",
+                  static_cast<unsigned long long>(report.requests), report.seconds);
+    out << line;
+    std::snprintf(line, sizeof(line), "  %-12s %.1f req/s\n", "Throughput", rps);
+    out << line;
+    std::snprintf(line, sizeof(line), "  %-12s %llu\n", "Connects", static_cast<unsigned long long>(report.connects));
+    out << line;
+    std::snprintf(line, sizeof(line), "  %-12s %llu\n", "Non-2xx/3xx", static_cast<unsigned long long>(report.non_success));
+    out << line;
+    std::snprintf(line, sizeof(line), "  %-12s %llu\n", "Errors", static_cast<unsigned long long>(report.errors));
+    out << line;
+
+    out << "\n  Latency\n";
+    std::snprintf(line, sizeof(line), "    %-8s %s\n", "mean", format_ns(report.latency.mean()).c_str());
+    out << line;
+
+    static const std::pair<const char*, double> ladder[] = {
+        {"p50", 0.50}, {"p90", 0.90}, {"p99", 0.99}, {"p99.9", 0.999}, {"p99.99", 0.9999},
+    };
+
+    for (const auto& [label, q] : ladder) {
+        std::snprintf(line, sizeof(line), "    %-8s %s\n", label,
+                      format_ns(static_cast<double>(report.latency.percentile(q))).c_str());
+        out << line;
+    }
+
+    std::snprintf(line, sizeof(line), "    %-8s %s\n", "max",
+                  format_ns(static_cast<double>(report.latency.max())).c_str());
+    out << line;
+}
+
+// ============================================================================
+// Server process
+// ============================================================================
+
+pid_t start_server(const std::string& exe) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    pid_t pid = -1;
+    char* argv[] = {const_cast<char*>(exe.c_str()), nullptr};
+    int rc = posix_spawn(&pid, exe.c_str(), &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    return rc == 0 ? pid : -1;
+}
+
+bool wait_for_port(const std::string& host, int port, pid_t server, int timeout_ms) {
+    boost::system::error_code ec;
+    auto address = boost::asio::ip::make_address(host, ec);
+
+    if (ec) {
+        return false;
+    }
+
+    tcp::endpoint endpoint(address, static_cast<unsigned short>(port));
+    boost::asio::io_context ctx;
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    while (Clock::now() < deadline) {
+        int status = 0;
+
+        if (server > 0 && waitpid(server, &status, WNOHANG) == server) {
+            return false;
+        }
+
+        tcp::socket probe(ctx);
+        probe.connect(endpoint, ec);
+
+        if (!ec) {
+            return true;
+        }
+
+        usleep(20 * 1000);
+    }
+
+    return false;
+}
+
+void stop_server(pid_t server) {
+    if (server <= 0) {
+        return;
+    }
+
+    int status = 0;
+    kill(server, SIGTERM);
+    waitpid(server, &status, 0);
+}
+
+}  // namespace bench
@@ -0,0 +1,98 @@
+/**
+ * @file bench_http.hpp
+ * @brief HTTP load generator behind `bishop bench-http`.
+ *
+ * Drives a local server from keep-alive connections spread over per-core
+ * fiber runtimes, pipelining a fixed number of requests per connection,
+ * and reports throughput and a latency histogram.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <sys/types.h>
+
+namespace bench {
+
+/**
+ * Load generator settings, filled in from `bishop bench-http` flags.
+ */
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::string path = "/";
+    int threads = 0;         // load generator threads; 0 = half the CPU cores
+    int connections = 64;    // open connections, split across threads
+    int pipeline = 1;        // requests written per connection before reading
+    double duration = 10.0;  // seconds of load
+    bool keep_alive = true;  // false opens a new connection per request
+};
+
+/**
+ * Log-linear latency histogram in nanoseconds. Each power of two is split
+ * into 32 buckets, so a reported percentile is within ~3% of the sample.
+ */
+class Histogram {
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr std::size_t BUCKETS = 64 << SUB_BITS;
+
+    void record(std::uint64_t ns);
+    void merge(const Histogram& other);
+
+    /** Smallest recorded value at or above the q quantile (0 < q <= 1). */
+    std::uint64_t percentile(double q) const;
+    std::uint64_t count() const { return count_; }
+    std::uint64_t max() const { return max_; }
+    double mean() const;
+
+private:
+    std::array<std::uint64_t, BUCKETS> counts_{};
+    std::uint64_t count_ = 0;
+    std::uint64_t max_ = 0;
+    long double sum_ = 0;
+};
+
+/**
+ * Totals of one run, merged from every load generator thread.
+ */
+struct Report {
+    std::uint64_t requests = 0;  // complete responses
+    std::uint64_t non_success = 0;  // responses outside 200-399
+    std::uint64_t errors = 0;    // failed connects, reads, writes and bad responses
+    std::uint64_t connects = 0;
+    double seconds = 0;
+    Histogram latency;
+};
+
+/**
+ * Runs the load generator against opts.host:opts.port for opts.duration
+ * seconds. Starts the fiber runtime on the calling thread, so call once.
+ */
+Report run(const Options& opts);
+
+/**
+ * Prints requests/s and the latency percentile ladder.
+ */
+void print(const Report& report, std::ostream& out);
+
+/**
+ * Starts a server binary with stdout discarded. Returns its pid, or -1.
+ */
+pid_t start_server(const std::string& exe);
+
+/**
+ * Polls until host:port accepts connections. Fails early if the server
+ * exits, or after timeout_ms.
+ */
+bool wait_for_port(const std::string& host, int port, pid_t server, int timeout_ms);
+
+/**
+ * Sends SIGTERM to the server and reaps it.
+ */
+void stop_server(pid_t server);
+
+}  // namespace bench
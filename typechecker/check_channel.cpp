@@ -17,6 +17,14 @@ TypeInfo check_channel_create(TypeCheckerState& state, const ChannelCreate& chan
         error(state, "unknown channel element type '" + channel.element_type + "'", channel.line);
     }
 
+    if (channel.capacity) {
+        TypeInfo capacity_type = infer_type(state, *channel.capacity);
+
+        if (capacity_type.base_type != "int") {
+            error(state, "Channel capacity must be int, got '" + format_type(capacity_type) + "'", channel.line);
+        }
+    }
+
     return {"Channel<" + channel.element_type + ">", false, false};
 }
 